@@ -0,0 +1,538 @@
+// distanceBenchmark.cpp
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+//==============================
+// Distance benchmark
+//==============================
+// Standalone benchmark of the distance kernels in src/, built without R against the distance core by the
+// Makefile in this directory.
+//
+// Every distance class created by DistanceFactory and DistanceDTWFactory is measured
+//   micro: single threaded block calls of the distance function (ns per pair)
+//   macro: parallel condensed distance vector like parDist (seconds and pairs per second per thread count)
+// over a sweep of observations, dimensions, sparsity (share of zero elements), series lengths and thread counts.
+// The results are written as JSON.
+//
+// Usage: distanceBenchmark [--n 1000,4000] [--dim 10,100] [--sparsity 0,0.9] [--dtw-n 200] [--length 50,200]
+//                          [--threads 1,<cores>] [--repetitions 3] [--methods euclidean,dtw,...]
+//                          [--output benchmark.json]
+
+#include "CoreBackend.h"
+
+#include <tbb/global_control.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DistanceCore.h"
+#include "DistanceFactory.h"
+#include "IDistance.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// minimal run time of a micro benchmark
+const double microSeconds = 0.05;
+// observations of a micro benchmark block
+const arma::uword microRows = 256;
+const arma::uword microCols = 32;
+// pairs of series of a dtw micro benchmark
+const unsigned int dtwMicroPairs = 16;
+
+double secondsSince(const Clock::time_point &start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//------------------------------
+// Options
+//------------------------------
+
+struct Options {
+    std::vector<double> n;
+    std::vector<double> dim;
+    std::vector<double> sparsity;
+    std::vector<double> dtwN;
+    std::vector<double> length;
+    std::vector<double> threads;
+    unsigned int repetitions;
+    std::vector<std::string> methods;
+    std::string output;
+
+    Options() : repetitions(3), output("benchmark.json") {
+        n = {1000, 4000};
+        dim = {10, 100};
+        sparsity = {0, 0.9};
+        dtwN = {200};
+        length = {50, 200};
+        threads = {1, static_cast<double>(std::max(1u, std::thread::hardware_concurrency()))};
+    }
+};
+
+std::vector<std::string> splitList(const std::string &str) {
+    std::vector<std::string> items;
+    std::stringstream stream(str);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+std::vector<double> splitNumbers(const std::string &str) {
+    std::vector<double> numbers;
+    std::vector<std::string> items = splitList(str);
+    for (std::size_t i = 0; i < items.size(); i++) {
+        numbers.push_back(std::atof(items[i].c_str()));
+    }
+    return numbers;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i], value = argv[i + 1];
+        if (key == "--n") {
+            options.n = splitNumbers(value);
+        } else if (key == "--dim") {
+            options.dim = splitNumbers(value);
+        } else if (key == "--sparsity") {
+            options.sparsity = splitNumbers(value);
+        } else if (key == "--dtw-n") {
+            options.dtwN = splitNumbers(value);
+        } else if (key == "--length") {
+            options.length = splitNumbers(value);
+        } else if (key == "--threads") {
+            options.threads = splitNumbers(value);
+        } else if (key == "--repetitions") {
+            options.repetitions = std::max(1, std::atoi(value.c_str()));
+        } else if (key == "--methods") {
+            options.methods = splitList(value);
+        } else if (key == "--output") {
+            options.output = value;
+        } else {
+            std::cerr << "Unknown option " << key << std::endl;
+            return false;
+        }
+    }
+    if (argc % 2 == 0) {
+        std::cerr << "Missing value of option " << argv[argc - 1] << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------
+// Benchmarked configurations
+//------------------------------
+
+// distance method with its additional arguments, as passed to parDist
+struct Method {
+    std::string name;
+    std::map<std::string, std::string> textArguments;
+    std::map<std::string, double> numberArguments;
+
+    std::string label() const {
+        std::string result = name;
+        for (std::map<std::string, std::string>::const_iterator it = textArguments.begin();
+             it != textArguments.end(); ++it) {
+            result += "," + it->first + "=" + it->second;
+        }
+        for (std::map<std::string, double>::const_iterator it = numberArguments.begin();
+             it != numberArguments.end(); ++it) {
+            std::ostringstream number;
+            number << it->second;
+            result += "," + it->first + "=" + number.str();
+        }
+        return result;
+    }
+
+    DistanceOptions options() const {
+        DistanceOptions result(name);
+        std::map<std::string, std::string>::const_iterator text;
+        std::map<std::string, double>::const_iterator number;
+        if ((text = textArguments.find("engine")) != textArguments.end()) {
+            result.engine = text->second;
+        }
+        if ((text = textArguments.find("step.pattern")) != textArguments.end()) {
+            result.stepPattern = text->second;
+        }
+        if ((text = textArguments.find("norm.method")) != textArguments.end()) {
+            result.normMethod = text->second;
+        }
+        if ((number = numberArguments.find("p")) != numberArguments.end()) {
+            result.p = number->second;
+        }
+        if ((number = numberArguments.find("window.size")) != numberArguments.end()) {
+            result.warpingWindow = true;
+            result.windowSize = static_cast<unsigned int>(number->second);
+        }
+        return result;
+    }
+};
+
+Method method(const std::string &name) {
+    Method result;
+    result.name = name;
+    return result;
+}
+
+Method method(const std::string &name, const std::string &key, const std::string &value) {
+    Method result = method(name);
+    result.textArguments[key] = value;
+    return result;
+}
+
+// every distance class of DistanceFactory for matrix input, custom distances need a user defined function
+std::vector<Method> matrixMethods() {
+    const char *names[] = {"bhjattacharyya", "bray", "canberra", "chord", "divergence", "fJaccard", "geodesic",
+                           "hellinger", "kullback", "cosine", "mahalanobis", "manhattan", "maximum", "minkowski",
+                           "podani", "soergel", "wave", "whittaker", "binary", "braun-blanquet", "dice",
+                           "fager", "faith", "hamman", "kulczynski1", "kulczynski2", "michael", "mountford",
+                           "mozley", "ochiai", "phi", "russel", "simple matching", "simpson", "stiles",
+                           "tanimoto", "yule", "yule2", "hamming", "euclidean"};
+    std::vector<Method> methods;
+    for (std::size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        methods.push_back(method(names[i]));
+    }
+    methods[13].numberArguments["p"] = 3;
+    // minkowski kernels of the other specialised, integer and real exponents
+    const double exponents[] = {1, 2, 4, 7, 2.5};
+    for (std::size_t i = 0; i < sizeof(exponents) / sizeof(exponents[0]); i++) {
+        methods.push_back(method("minkowski"));
+        methods.back().numberArguments["p"] = exponents[i];
+    }
+    // block engine of the inner product based distances
+    const char *gramNames[] = {"chord", "geodesic", "cosine", "euclidean"};
+    for (std::size_t i = 0; i < sizeof(gramNames) / sizeof(gramNames[0]); i++) {
+        methods.push_back(method(gramNames[i], "engine", "gemm"));
+    }
+    return methods;
+}
+
+// every step pattern of DistanceDTWFactory, with and without warping window
+std::vector<Method> dtwMethods() {
+    const char *patterns[] = {"symmetric1",   "symmetric2",    "symmetricP05",  "symmetricP1",
+                              "symmetricP2",  "asymmetric",    "asymmetricP0",  "asymmetricP05",
+                              "asymmetricP1", "asymmetricP2"};
+    std::vector<Method> methods;
+    for (std::size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        methods.push_back(method("dtw", "step.pattern", patterns[i]));
+    }
+    Method window = method("dtw", "step.pattern", "symmetric1");
+    window.numberArguments["window.size"] = 10;
+    methods.push_back(window);
+    Method normalized = method("dtw", "step.pattern", "symmetric2");
+    normalized.textArguments["norm.method"] = "n+m";
+    methods.push_back(normalized);
+    return methods;
+}
+
+bool selected(const Options &options, const Method &method) {
+    if (options.methods.empty()) {
+        return true;
+    }
+    for (std::size_t i = 0; i < options.methods.size(); i++) {
+        if (options.methods[i] == method.name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// uniform random values of which the share sparsity is zero
+arma::mat randomMatrix(std::mt19937 &generator, arma::uword rows, arma::uword cols, double sparsity) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    arma::mat data(rows, cols);
+    for (arma::uword i = 0; i < data.n_elem; i++) {
+        data[i] = uniform(generator) < sparsity ? 0.0 : uniform(generator);
+    }
+    return data;
+}
+
+//------------------------------
+// Results
+//------------------------------
+
+std::string jsonString(const std::string &str) {
+    std::string result = "\"";
+    for (std::size_t i = 0; i < str.size(); i++) {
+        char c = str[i];
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            result += escaped;
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+std::string jsonNumber(double value) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    std::ostringstream stream;
+    stream.precision(9);
+    stream << value;
+    return stream.str();
+}
+
+// one JSON object per measurement
+class Results {
+  private:
+    std::vector<std::string> entries;
+
+  public:
+    void add(const std::string &kind, const Method &method, const std::map<std::string, double> &parameters,
+             const std::map<std::string, double> &measurements, const std::string &error) {
+        std::string entry = "{\"kind\": " + jsonString(kind) + ", \"method\": " + jsonString(method.name) +
+                            ", \"configuration\": " + jsonString(method.label());
+        for (std::map<std::string, double>::const_iterator it = parameters.begin(); it != parameters.end(); ++it) {
+            entry += ", " + jsonString(it->first) + ": " + jsonNumber(it->second);
+        }
+        for (std::map<std::string, double>::const_iterator it = measurements.begin(); it != measurements.end();
+             ++it) {
+            entry += ", " + jsonString(it->first) + ": " + jsonNumber(it->second);
+        }
+        if (!error.empty()) {
+            entry += ", \"error\": " + jsonString(error);
+        }
+        entries.push_back(entry + "}");
+        std::cerr << kind << " " << method.label() << (error.empty() ? "" : " failed: " + error) << std::endl;
+    }
+
+    void write(std::ostream &stream, const Options &options) const {
+        stream << "{\n  \"benchmark\": \"parallelDist\",\n  \"hardwareConcurrency\": "
+               << std::thread::hardware_concurrency() << ",\n  \"repetitions\": " << options.repetitions
+               << ",\n  \"results\": [";
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            stream << (i == 0 ? "\n    " : ",\n    ") << entries[i];
+        }
+        stream << "\n  ]\n}\n";
+    }
+};
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    std::size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+// limits the threads of the parallel loops while alive
+std::unique_ptr<tbb::global_control> threadLimit(double threads) {
+    return std::unique_ptr<tbb::global_control>(
+        new tbb::global_control(tbb::global_control::max_allowed_parallelism, static_cast<std::size_t>(threads)));
+}
+
+//------------------------------
+// Measurements
+//------------------------------
+
+// single threaded block calls on the first rows and columns of the observations
+std::map<std::string, double> microMatrix(const std::shared_ptr<IDistance> &distance, const arma::mat &observations) {
+    arma::uword rows = std::min(microRows, observations.n_cols);
+    arma::uword cols = std::min(microCols, observations.n_cols);
+    std::vector<double> buffer(rows * cols);
+    std::vector<double *> out(cols);
+    for (arma::uword c = 0; c < cols; c++) {
+        out[c] = &buffer[c * rows];
+    }
+    uint64_t pairs = 0;
+    Clock::time_point start = Clock::now();
+    do {
+        distance->calcBlockDistances(observations.colptr(0), rows, observations.colptr(0), cols, observations.n_rows,
+                                     out.data());
+        pairs += rows * cols;
+    } while (secondsSince(start) < microSeconds);
+    std::map<std::string, double> measurements;
+    measurements["nsPerPair"] = secondsSince(start) * 1e9 / pairs;
+    return measurements;
+}
+
+// single threaded distances between the first series
+std::map<std::string, double> microSeries(const std::shared_ptr<IDistance> &distance,
+                                          const std::vector<arma::mat> &series) {
+    unsigned int count = std::min<unsigned int>(dtwMicroPairs, series.size() - 1);
+    uint64_t pairs = 0;
+    double cells = 0;
+    Clock::time_point start = Clock::now();
+    do {
+        for (unsigned int i = 0; i < count; i++) {
+            distance->calcDistance(series[i], series[i + 1]);
+            cells += static_cast<double>(series[i].n_cols) * series[i + 1].n_cols;
+        }
+        pairs += count;
+    } while (secondsSince(start) < microSeconds);
+    double seconds = secondsSince(start);
+    std::map<std::string, double> measurements;
+    measurements["nsPerPair"] = seconds * 1e9 / pairs;
+    measurements["nsPerCell"] = seconds * 1e9 / cells;
+    return measurements;
+}
+
+// parallel condensed distance vector, median over the repetitions
+template <typename Calculation>
+std::map<std::string, double> macro(const Options &options, double size, Calculation calculation) {
+    std::vector<double> seconds;
+    for (unsigned int r = 0; r < options.repetitions; r++) {
+        Clock::time_point start = Clock::now();
+        calculation();
+        seconds.push_back(secondsSince(start));
+    }
+    std::map<std::string, double> measurements;
+    measurements["seconds"] = median(seconds);
+    measurements["minSeconds"] = *std::min_element(seconds.begin(), seconds.end());
+    measurements["pairsPerSecond"] = size * (size - 1) / 2 / median(seconds);
+    return measurements;
+}
+
+void benchmarkMatrices(const Options &options, Results &results) {
+    std::vector<Method> methods = matrixMethods();
+    std::mt19937 generator(42);
+    for (std::size_t in = 0; in < options.n.size(); in++) {
+        for (std::size_t id = 0; id < options.dim.size(); id++) {
+            for (std::size_t is = 0; is < options.sparsity.size(); is++) {
+                double n = options.n[in], dim = options.dim[id], sparsity = options.sparsity[is];
+                if (n < 2 || dim < 1) {
+                    continue;
+                }
+                arma::mat data = randomMatrix(generator, n, dim, sparsity);
+                for (std::size_t m = 0; m < methods.size(); m++) {
+                    const Method &method = methods[m];
+                    if (!selected(options, method)) {
+                        continue;
+                    }
+                    DistanceOptions distanceOptions = method.options();
+                    std::map<std::string, double> parameters;
+                    parameters["n"] = n;
+                    parameters["dim"] = dim;
+                    parameters["sparsity"] = sparsity;
+                    try {
+                        std::shared_ptr<IDistance> distance =
+                            DistanceFactory(data).createDistanceFunction(distanceOptions);
+                        results.add("micro", method, parameters,
+                                    microMatrix(distance, rowObservations(data, *distance)), "");
+                    } catch (std::exception &e) {
+                        results.add("micro", method, parameters, std::map<std::string, double>(), e.what());
+                        continue;
+                    }
+                    std::vector<double> output(sumForm(static_cast<uint64_t>(n)) - static_cast<uint64_t>(n));
+                    for (std::size_t it = 0; it < options.threads.size(); it++) {
+                        parameters["threads"] = options.threads[it];
+                        std::unique_ptr<tbb::global_control> limit = threadLimit(options.threads[it]);
+                        try {
+                            results.add("macro", method, parameters, macro(options, n, [&]() {
+                                            Progress progress;
+                                            calcDistMatrix(data, distanceOptions, output.data(), progress);
+                                        }),
+                                        "");
+                        } catch (std::exception &e) {
+                            results.add("macro", method, parameters, std::map<std::string, double>(), e.what());
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void benchmarkSeries(const Options &options, Results &results) {
+    std::vector<Method> methods = dtwMethods();
+    std::mt19937 generator(42);
+    for (std::size_t in = 0; in < options.dtwN.size(); in++) {
+        for (std::size_t il = 0; il < options.length.size(); il++) {
+            double n = options.dtwN[in], length = options.length[il];
+            if (n < 2 || length < 1) {
+                continue;
+            }
+            std::vector<arma::mat> series;
+            for (double i = 0; i < n; i++) {
+                series.push_back(randomMatrix(generator, 1, length, 0));
+            }
+            std::vector<double> output(sumForm(static_cast<uint64_t>(n)) - static_cast<uint64_t>(n));
+            for (std::size_t m = 0; m < methods.size(); m++) {
+                const Method &method = methods[m];
+                if (!selected(options, method)) {
+                    continue;
+                }
+                DistanceOptions distanceOptions = method.options();
+                std::map<std::string, double> parameters;
+                parameters["n"] = n;
+                parameters["length"] = length;
+                try {
+                    std::shared_ptr<IDistance> distance =
+                        DistanceFactory(series).createDistanceFunction(distanceOptions);
+                    results.add("micro", method, parameters, microSeries(distance, series), "");
+                } catch (std::exception &e) {
+                    results.add("micro", method, parameters, std::map<std::string, double>(), e.what());
+                    continue;
+                }
+                for (std::size_t it = 0; it < options.threads.size(); it++) {
+                    parameters["threads"] = options.threads[it];
+                    std::unique_ptr<tbb::global_control> limit = threadLimit(options.threads[it]);
+                    try {
+                        results.add("macro", method, parameters, macro(options, n, [&]() {
+                                        Progress progress;
+                                        calcDistVec(series, distanceOptions, output.data(), progress);
+                                    }),
+                                    "");
+                    } catch (std::exception &e) {
+                        results.add("macro", method, parameters, std::map<std::string, double>(), e.what());
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    Results results;
+    benchmarkMatrices(options, results);
+    benchmarkSeries(options, results);
+
+    std::ofstream output(options.output.c_str());
+    results.write(output, options);
+    std::cerr << "Results written to " << options.output << std::endl;
+    return 0;
+}
@@ -20,7 +20,94 @@
 #ifndef BINARYCOUNT_H_
 #define BINARYCOUNT_H_
 
-#include <RcppArmadillo.h>
+#include "CoreBackend.h"
+#include <algorithm>
+#include <cstring>
+
+// the hardware popcount instruction is selected at runtime, the package is not compiled for a specific CPU
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BINARYCOUNT_POPCNT_DISPATCH
+#endif
+
+//==============================
+// Packed observations
+//==============================
+// An observation is packed by replacing its values by the bits (value != 0) in 32-bit words, which take no more
+// memory than the values in single or double precision. Unused bits of the last word are zero.
+namespace packed {
+
+inline arma::uword wordCount(arma::uword len) {
+    return (len + 31) / 32;
+}
+
+inline unsigned int popcount(uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<unsigned int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// set bits of x, y and x & y over the words of two packed observations, two words are counted at once
+inline void countBits(const unsigned char *x, const unsigned char *y, arma::uword words, uint64_t &xBits,
+                      uint64_t &yBits, uint64_t &bothBits) {
+    uint64_t nx = 0, ny = 0, nxy = 0;
+    arma::uword k = 0;
+    for (; k + 2 <= words; k += 2) {
+        uint64_t u, v;
+        std::memcpy(&u, x + 4 * k, sizeof(u));
+        std::memcpy(&v, y + 4 * k, sizeof(v));
+        nx += popcount(u);
+        ny += popcount(v);
+        nxy += popcount(u & v);
+    }
+    if (k < words) {
+        uint32_t u, v;
+        std::memcpy(&u, x + 4 * k, sizeof(u));
+        std::memcpy(&v, y + 4 * k, sizeof(v));
+        nx += popcount(u);
+        ny += popcount(v);
+        nxy += popcount(u & v);
+    }
+    xBits = nx;
+    yBits = ny;
+    bothBits = nxy;
+}
+
+#ifdef BINARYCOUNT_POPCNT_DISPATCH
+__attribute__((target("popcnt"))) inline void countBitsPopcnt(const unsigned char *x, const unsigned char *y,
+                                                                arma::uword words, uint64_t &xBits,
+                                                                uint64_t &yBits, uint64_t &bothBits) {
+    countBits(x, y, words, xBits, yBits, bothBits);
+}
+
+inline bool hasPopcnt() {
+    static const bool supported = __builtin_cpu_supports("popcnt");
+    return supported;
+}
+#endif
+
+/**
+ Packs an observation in place, the values are read before the words overlapping them are written.
+ @param x observation, the first 4 * wordCount(len) bytes hold the packed observation on return
+ @param len number of elements of the observation
+ */
+inline void pack(double *x, arma::uword len) {
+    unsigned char *bytes = reinterpret_cast<unsigned char *>(x);
+    for (arma::uword k = 0; k < wordCount(len); ++k) {
+        uint32_t word = 0;
+        arma::uword end = std::min<arma::uword>(len, 32 * (k + 1));
+        for (arma::uword i = 32 * k; i < end; ++i) {
+            word |= static_cast<uint32_t>(x[i] != 0) << (i - 32 * k);
+        }
+        std::memcpy(bytes + 4 * k, &word, sizeof(word));
+    }
+}
+
+} // namespace packed
 
 class BinaryCount {
   private:
@@ -33,38 +120,57 @@ class BinaryCount {
     BinaryCount(uint64_t a, uint64_t b, uint64_t c, uint64_t d) : a(a), b(b), c(c), d(d) {}
     ~BinaryCount() {}
     static BinaryCount getBinaryCount(const arma::mat &A, const arma::mat &B) {
+        return getBinaryCount(A.memptr(), B.memptr(), A.size());
+    }
+    template <typename T> static BinaryCount getBinaryCount(const T *A, const T *B, arma::uword len) {
         uint64_t a = 0;
         uint64_t b = 0;
         uint64_t c = 0;
         uint64_t d = 0;
 
-        for (arma::uword idx = 0; idx < A.size(); ++idx) {
-            bool aZero = A.at(idx) == 0.0;
-            bool bZero = B.at(idx) == 0.0;
-
-            if (!aZero && !bZero) {
-                ++a;
-            } else if (!aZero && bZero) {
-                ++b;
-            } else if (aZero && !bZero) {
-                ++c;
-            } else if (aZero && bZero) {
-                ++d;
-            }
+        for (arma::uword idx = 0; idx < len; ++idx) {
+            bool aNonzero = A[idx] != 0;
+            bool bNonzero = B[idx] != 0;
+            a += aNonzero && bNonzero;
+            b += aNonzero && !bNonzero;
+            c += !aNonzero && bNonzero;
         }
+        d = len - a - b - c;
 
         return BinaryCount(a, b, c, d);
     }
-    uint64_t getA() {
+    /**
+     Counts of two observations packed by packed::pack, the element type only gives the storage of the words.
+     @param A first packed observation
+     @param B second packed observation
+     @param len number of elements of the observations before packing
+     @return counts of the observations
+     */
+    template <typename T> static BinaryCount getPackedBinaryCount(const T *A, const T *B, arma::uword len) {
+        const unsigned char *x = reinterpret_cast<const unsigned char *>(A);
+        const unsigned char *y = reinterpret_cast<const unsigned char *>(B);
+        uint64_t xBits, yBits, bothBits;
+#ifdef BINARYCOUNT_POPCNT_DISPATCH
+        if (packed::hasPopcnt()) {
+            packed::countBitsPopcnt(x, y, packed::wordCount(len), xBits, yBits, bothBits);
+        } else {
+            packed::countBits(x, y, packed::wordCount(len), xBits, yBits, bothBits);
+        }
+#else
+        packed::countBits(x, y, packed::wordCount(len), xBits, yBits, bothBits);
+#endif
+        return BinaryCount(bothBits, xBits - bothBits, yBits - bothBits, len - xBits - yBits + bothBits);
+    }
+    uint64_t getA() const {
         return a;
     }
-    uint64_t getB() {
+    uint64_t getB() const {
         return b;
     }
-    uint64_t getC() {
+    uint64_t getC() const {
         return c;
     }
-    uint64_t getD() {
+    uint64_t getD() const {
         return d;
     }
 };
@@ -0,0 +1,104 @@
+// CoreBackend.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef COREBACKEND_H_
+#define COREBACKEND_H_
+
+//==============================
+// Core backend
+//==============================
+// The distance core (metrics, factories, tiling and scheduler) reaches its libraries only through this header.
+// Inside the package, armadillo is configured by RcppArmadillo and the parallel loops run on RcppParallel, which
+// follows setThreadOptions. With PARALLELDIST_STANDALONE defined, the core builds without R against armadillo
+// and TBB directly, the number of threads is then controlled by the caller, e.g. with tbb::global_control.
+
+#ifdef PARALLELDIST_STANDALONE
+
+#include <armadillo>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include <cstddef>
+
+namespace backend {
+
+// body of a parallel loop, processes the indices [begin, end)
+struct Worker {
+    virtual ~Worker() {}
+    virtual void operator()(std::size_t begin, std::size_t end) = 0;
+};
+
+// tag of the split constructor of a reducer
+struct Split {};
+
+inline void parallelFor(std::size_t begin, std::size_t end, Worker &worker, std::size_t grainSize = 1) {
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(begin, end, grainSize),
+                      [&worker](const tbb::blocked_range<std::size_t> &range) { worker(range.begin(), range.end()); });
+}
+
+// reducer body of TBB, split reducers are owned by their body
+template <typename Reducer> struct ReducerBody {
+    Reducer *reducer;
+    bool owned;
+
+    explicit ReducerBody(Reducer &reducer) : reducer(&reducer), owned(false) {}
+
+    ReducerBody(ReducerBody &other, tbb::split) : reducer(new Reducer(*other.reducer, Split())), owned(true) {}
+
+    ~ReducerBody() {
+        if (owned) {
+            delete reducer;
+        }
+    }
+
+    void operator()(const tbb::blocked_range<std::size_t> &range) {
+        (*reducer)(range.begin(), range.end());
+    }
+
+    void join(const ReducerBody &other) {
+        reducer->join(*other.reducer);
+    }
+};
+
+template <typename Reducer>
+void parallelReduce(std::size_t begin, std::size_t end, Reducer &reducer, std::size_t grainSize = 1) {
+    ReducerBody<Reducer> body(reducer);
+    tbb::parallel_reduce(tbb::blocked_range<std::size_t>(begin, end, grainSize), body);
+}
+
+} // namespace backend
+
+#else
+
+#include <RcppArmadillo.h>
+#include <RcppParallel.h>
+
+namespace backend {
+
+using RcppParallel::Split;
+using RcppParallel::Worker;
+using RcppParallel::parallelFor;
+using RcppParallel::parallelReduce;
+
+} // namespace backend
+
+#endif
+
+#endif // COREBACKEND_H_
@@ -21,22 +21,90 @@
 #define DISTANCEBINARY_H_
 
 #include "BinaryCount.h"
+#include "DistanceGramKernel.h"
+#include "DistanceRowKernel.h"
 #include "IDistance.h"
 #include "Util.h"
-#include <RcppArmadillo.h>
 #include <cmath>
 
 #undef max
 #define minOfPair(x, y) ((x) < (y) ? (x) : (y))
 #define maxOfPair(x, y) ((x) < (y) ? (y) : (x))
 
+//==============================
+// Binary measure
+//==============================
+// Formula of a binary distance on the contingency counts, for callers which take the counts of a pair once and
+// evaluate several measures on them
+class IBinaryMeasure {
+  public:
+    virtual ~IBinaryMeasure() {}
+    virtual double calcMeasure(const BinaryCount &bc, uword n) = 0;
+};
+
+//==============================
+// Binary distance generic
+//==============================
+// The implementation provides the formula on the contingency counts of two observations
+//   double calcDistance(const BinaryCount &bc, uword n)
+// where n is the number of variables. Observations of the row interface are packed into bits once, so the counts
+// of a pair are taken by popcount of whole words. With the matrix product engine, observations are prepared as
+// 0/1 indicators instead, a = xy is taken from the product of a block pair and the numbers of nonzero elements
+// a + b = xx and a + c = yy from the squared norms.
+template <typename Implementation>
+class DistanceBinaryGeneric : public DistanceGramKernel<Implementation>, public IBinaryMeasure {
+  private:
+    inline Implementation &impl() {
+        return *static_cast<Implementation *>(this);
+    }
+
+  public:
+    explicit DistanceBinaryGeneric(bool gramEngine = false) : DistanceGramKernel<Implementation>(gramEngine) {}
+
+    double calcDistance(const arma::mat &A, const arma::mat &B) {
+        return impl().calcDistance(BinaryCount::getBinaryCount(A, B), A.n_cols);
+    }
+    bool preparesObservations() {
+        return true;
+    }
+    bool packsObservations() {
+        return !this->usesGramEngine();
+    }
+    void prepare(double *x, uword len) {
+        if (!this->usesGramEngine()) {
+            packed::pack(x, len);
+            return;
+        }
+        for (uword i = 0; i < len; ++i) {
+            x[i] = x[i] != 0;
+        }
+    }
+    double calcMeasure(const BinaryCount &bc, uword n) {
+        return impl().calcDistance(bc, n);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        BinaryCount bc = this->usesGramEngine() ? BinaryCount::getBinaryCount(a, b, len)
+                                                : BinaryCount::getPackedBinaryCount(a, b, len);
+        return static_cast<T>(impl().calcDistance(bc, len));
+    }
+    // the counts are exact integers, the products of 0/1 indicators never cancel
+    bool gramDistance(double xy, double xx, double yy, uword len, double, double &dist) {
+        uint64_t a = static_cast<uint64_t>(xy + 0.5);
+        uint64_t x = static_cast<uint64_t>(xx + 0.5);
+        uint64_t y = static_cast<uint64_t>(yy + 0.5);
+        dist = impl().calcDistance(BinaryCount(a, x - a, y - a, len - x - y + a), len);
+        return true;
+    }
+};
+
 //=======================
 // Binary distance
 //=======================
-class DistanceBinary : public IDistance {
+class DistanceBinary : public DistanceBinaryGeneric<DistanceBinary> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceBinary>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceBinary>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         uint64_t denominator = bc.getA() + bc.getB() + bc.getC();
         return ((denominator == 0) ? 0 : static_cast<double>(bc.getB() + bc.getC()) / denominator);
     }
@@ -45,10 +113,11 @@ class DistanceBinary : public IDistance {
 //=======================
 // Braun-Blanquet
 //=======================
-class DistanceBraunblanquet : public IDistance {
+class DistanceBraunblanquet : public DistanceBinaryGeneric<DistanceBraunblanquet> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceBraunblanquet>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceBraunblanquet>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         uint64_t denominator = maxOfPair((bc.getA() + bc.getB()), (bc.getA() + bc.getC()));
         return util::similarityToDistance(static_cast<double>(bc.getA()) / denominator);
     }
@@ -57,10 +126,11 @@ class DistanceBraunblanquet : public IDistance {
 //=======================
 // Dice distance
 //=======================
-class DistanceDice : public IDistance {
+class DistanceDice : public DistanceBinaryGeneric<DistanceDice> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceDice>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceDice>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         uint64_t denominator = 2 * bc.getA() + bc.getB() + bc.getC();
         return util::similarityToDistance(static_cast<double>(2 * bc.getA()) / denominator);
     }
@@ -69,10 +139,11 @@ class DistanceDice : public IDistance {
 //=======================
 // Fager distance (like in proxy)
 //=======================
-class DistanceFager : public IDistance {
+class DistanceFager : public DistanceBinaryGeneric<DistanceFager> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceFager>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceFager>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         return util::similarityToDistance(
             (static_cast<double>(bc.getA()) /
              std::sqrt(static_cast<double>((bc.getA() + bc.getB()) * (bc.getA() + bc.getC())))) -
@@ -83,33 +154,36 @@ class DistanceFager : public IDistance {
 //=======================
 // Faith distance
 //=======================
-class DistanceFaith : public IDistance {
+class DistanceFaith : public DistanceBinaryGeneric<DistanceFaith> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
-        return util::similarityToDistance((bc.getA() + static_cast<double>(bc.getD()) / 2.0) / A.n_cols);
+    using DistanceBinaryGeneric<DistanceFaith>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceFaith>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword n) {
+        return util::similarityToDistance((bc.getA() + static_cast<double>(bc.getD()) / 2.0) / n);
     }
 };
 
 //=======================
 // Hamman distance
 //=======================
-class DistanceHamman : public IDistance {
+class DistanceHamman : public DistanceBinaryGeneric<DistanceHamman> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceHamman>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceHamman>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword n) {
         return util::similarityToDistance(
-            (static_cast<double>(bc.getA()) + bc.getD() - bc.getB() - bc.getC()) / A.n_cols);
+            (static_cast<double>(bc.getA()) + bc.getD() - bc.getB() - bc.getC()) / n);
     }
 };
 
 //=======================
 // Kulczynski1 distance
 //=======================
-class DistanceKulczynski1 : public IDistance {
+class DistanceKulczynski1 : public DistanceBinaryGeneric<DistanceKulczynski1> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceKulczynski1>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceKulczynski1>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         return util::similarityToDistance(static_cast<double>(bc.getA()) / (bc.getB() + bc.getC()));
     }
 };
@@ -117,10 +191,11 @@ class DistanceKulczynski1 : public IDistance {
 //=======================
 // Kulczynski2 distance
 //=======================
-class DistanceKulczynski2 : public IDistance {
+class DistanceKulczynski2 : public DistanceBinaryGeneric<DistanceKulczynski2> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceKulczynski2>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceKulczynski2>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         double div1 = static_cast<double>(bc.getA()) / (bc.getA() + bc.getB());
         double div2 = static_cast<double>(bc.getA()) / (bc.getA() + bc.getC());
         return util::similarityToDistance((div1 + div2) / 2.0);
@@ -130,10 +205,11 @@ class DistanceKulczynski2 : public IDistance {
 //=======================
 // Michael distance
 //=======================
-class DistanceMichael : public IDistance {
+class DistanceMichael : public DistanceBinaryGeneric<DistanceMichael> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceMichael>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceMichael>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         double denominator = std::pow(static_cast<double>(bc.getA() + bc.getD()), 2) +
                              std::pow(static_cast<double>(bc.getB() + bc.getC()), 2);
         return util::similarityToDistance((4.0 * (static_cast<double>(bc.getA() * bc.getD()) -
@@ -145,10 +221,11 @@ class DistanceMichael : public IDistance {
 //=======================
 // Mountford distance
 //=======================
-class DistanceMountford : public IDistance {
+class DistanceMountford : public DistanceBinaryGeneric<DistanceMountford> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceMountford>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceMountford>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         uint64_t denominator = bc.getA() * (bc.getB() + bc.getC()) + 2 * bc.getB() * bc.getC();
         return util::similarityToDistance(static_cast<double>(2 * bc.getA()) / denominator);
     }
@@ -157,22 +234,24 @@ class DistanceMountford : public IDistance {
 //=======================
 // Mozley distance
 //=======================
-class DistanceMozley : public IDistance {
+class DistanceMozley : public DistanceBinaryGeneric<DistanceMozley> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceMozley>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceMozley>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword n) {
         uint64_t denominator = (bc.getA() + bc.getB()) * (bc.getA() + bc.getC());
-        return util::similarityToDistance((static_cast<double>(bc.getA() * A.n_cols)) / denominator);
+        return util::similarityToDistance((static_cast<double>(bc.getA() * n)) / denominator);
     }
 };
 
 //=======================
 // Ochiai distance
 //=======================
-class DistanceOchiai : public IDistance {
+class DistanceOchiai : public DistanceBinaryGeneric<DistanceOchiai> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceOchiai>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceOchiai>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         double denominator = std::sqrt(static_cast<double>((bc.getA() + bc.getB()) * (bc.getA() + bc.getC())));
         return util::similarityToDistance(static_cast<double>(bc.getA()) / denominator);
     }
@@ -181,10 +260,11 @@ class DistanceOchiai : public IDistance {
 //=======================
 // Phi distance
 //=======================
-class DistancePhi : public IDistance {
+class DistancePhi : public DistanceBinaryGeneric<DistancePhi> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistancePhi>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistancePhi>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         double denominator = (std::sqrt(static_cast<double>(bc.getA() + bc.getB())) *
                               std::sqrt(static_cast<double>(bc.getC() + bc.getD())) *
                               std::sqrt(static_cast<double>(bc.getA() + bc.getC())) *
@@ -197,32 +277,35 @@ class DistancePhi : public IDistance {
 //=======================
 // Russel distance
 //=======================
-class DistanceRussel : public IDistance {
+class DistanceRussel : public DistanceBinaryGeneric<DistanceRussel> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
-        return util::similarityToDistance(static_cast<double>(bc.getA()) / A.n_cols);
+    using DistanceBinaryGeneric<DistanceRussel>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceRussel>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword n) {
+        return util::similarityToDistance(static_cast<double>(bc.getA()) / n);
     }
 };
 
 //=======================
 // SimpleMatching distance
 //=======================
-class DistanceSimplematching : public IDistance {
+class DistanceSimplematching : public DistanceBinaryGeneric<DistanceSimplematching> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
-        return util::similarityToDistance(static_cast<double>(bc.getA() + bc.getD()) / A.n_cols);
+    using DistanceBinaryGeneric<DistanceSimplematching>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceSimplematching>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword n) {
+        return util::similarityToDistance(static_cast<double>(bc.getA() + bc.getD()) / n);
     }
 };
 
 //=======================
 // Simpson distance
 //=======================
-class DistanceSimpson : public IDistance {
+class DistanceSimpson : public DistanceBinaryGeneric<DistanceSimpson> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceSimpson>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceSimpson>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         uint64_t denominator = minOfPair((bc.getA() + bc.getB()), (bc.getA() + bc.getC()));
         return util::similarityToDistance(static_cast<double>(bc.getA()) / denominator);
     }
@@ -231,11 +314,11 @@ class DistanceSimpson : public IDistance {
 //=======================
 // Stiles distance
 //=======================
-class DistanceStiles : public IDistance {
+class DistanceStiles : public DistanceBinaryGeneric<DistanceStiles> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
-        unsigned int n = A.n_cols;
+    using DistanceBinaryGeneric<DistanceStiles>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceStiles>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword n) {
         return util::similarityToDistance(
             (std::log(static_cast<double>(n)) +
              2 * std::log(std::abs(static_cast<double>(bc.getA() * bc.getD()) - bc.getB() * bc.getC()) - n / 2.0) -
@@ -247,10 +330,11 @@ class DistanceStiles : public IDistance {
 //=======================
 // Tanimoto distance
 //=======================
-class DistanceTanimoto : public IDistance {
+class DistanceTanimoto : public DistanceBinaryGeneric<DistanceTanimoto> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceTanimoto>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceTanimoto>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         uint64_t denominator = bc.getA() + 2 * bc.getB() + 2 * bc.getC() + bc.getD();
         return util::similarityToDistance(static_cast<double>(bc.getA() + bc.getD()) / denominator);
     }
@@ -259,10 +343,11 @@ class DistanceTanimoto : public IDistance {
 //=======================
 // Yule distance
 //=======================
-class DistanceYule : public IDistance {
+class DistanceYule : public DistanceBinaryGeneric<DistanceYule> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceYule>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceYule>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         uint64_t denominator = (bc.getA() * bc.getD()) + (bc.getB() * bc.getC());
         return util::similarityToDistance((static_cast<double>(bc.getA() * bc.getD()) -
                                            (bc.getB() * bc.getC())) /
@@ -273,10 +358,11 @@ class DistanceYule : public IDistance {
 //=======================
 // Yule2 distance
 //=======================
-class DistanceYule2 : public IDistance {
+class DistanceYule2 : public DistanceBinaryGeneric<DistanceYule2> {
   public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        BinaryCount bc = BinaryCount::getBinaryCount(A, B);
+    using DistanceBinaryGeneric<DistanceYule2>::DistanceBinaryGeneric;
+    using DistanceBinaryGeneric<DistanceYule2>::calcDistance;
+    double calcDistance(const BinaryCount &bc, uword) {
         double denominator = std::sqrt(static_cast<double>(bc.getA() * bc.getD())) +
                              std::sqrt(static_cast<double>(bc.getB() * bc.getC()));
         return util::similarityToDistance((std::sqrt(static_cast<double>(bc.getA() * bc.getD())) -
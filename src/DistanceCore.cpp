@@ -0,0 +1,1074 @@
+// DistanceCore.cpp
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#include "DistanceCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "DistanceBinary.h"
+#include "DistanceElements.h"
+#include "DistanceFactory.h"
+#include "DistanceSparse.h"
+#include "Tiling.h"
+#include "Util.h"
+
+// element operations below which a calculation runs on the calling thread
+const uint64_t serialWork = 1 << 16;
+
+// prepares contiguous observations for the row distances
+struct PrepareObservations : public backend::Worker {
+    // observations as columns, prepared in place
+    arma::mat &observations;
+
+    // distance function
+    IDistance &distance;
+
+    PrepareObservations(arma::mat &observations, IDistance &distance)
+        : observations(observations), distance(distance) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        distance.prepareObservations(observations.colptr(begin), end - begin, observations.n_rows);
+    }
+};
+
+// element type T of the output is double or float
+template <typename T> struct DistanceVec : public backend::Worker {
+    // input vector of matrices
+    const std::vector<arma::mat> &seriesVec;
+
+    int vecSize = 0;
+
+    // condensed output vector, held by an R vector or a mapped file
+    T *output;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    DistanceVec(const std::vector<arma::mat> &seriesVec, T *output,
+                const std::shared_ptr<IDistance> &distance, const TriangularTiling &tiling)
+        : seriesVec(seriesVec), output(output), distance(distance), tiling(tiling) {
+        vecSize = seriesVec.size();
+    }
+
+    // processes the work items [begin, end) of the tiling
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        for (std::size_t k = begin; k < end; k++) {
+            unsigned int tileCount = tiling.getTiles(k, tiles);
+            for (unsigned int t = 0; t < tileCount; t++) {
+                const Tile &tile = tiles[t];
+                // a column of a tile is a contiguous run of the dist vector
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    uint64_t i = std::max(tile.rowBegin, j + 1);
+                    if (i >= tile.rowEnd) {
+                        continue;
+                    }
+                    T *out = &output[matToVecIdx(j, i, vecSize)];
+                    for (; i < tile.rowEnd; i++) {
+                        *out++ = static_cast<T>(distance->calcDistance(seriesVec.at(i), seriesVec.at(j)));
+                    }
+                }
+            }
+        }
+    }
+};
+
+// uses not a list but the matrix, observations and output have the element type T (double or float)
+template <typename T> struct DistanceMatrixVec : public backend::Worker {
+    // input observations, column i is a contiguous copy of row i of the input matrix
+    const arma::Mat<T> &observations;
+
+    int vecSize = 0;
+
+    // condensed output vector, held by an R vector or a mapped file
+    T *output;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    DistanceMatrixVec(const arma::Mat<T> &observations, T *output,
+                      const std::shared_ptr<IDistance> &distance, const TriangularTiling &tiling)
+        : observations(observations), output(output), distance(distance), tiling(tiling) {
+        vecSize = observations.n_cols;
+    }
+
+    // processes the work items [begin, end) of the tiling
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        // the worker is called once per work item, so the column pointers live on the stack unless a tiling with
+        // larger tiles was requested
+        T *stackColumns[TriangularTiling::maxTileSize];
+        std::vector<T *> heapColumns;
+        T **columns = stackColumns;
+        if (tiling.getTileSize() > TriangularTiling::maxTileSize) {
+            heapColumns.resize(tiling.getTileSize());
+            columns = heapColumns.data();
+        }
+        for (std::size_t k = begin; k < end; k++) {
+            unsigned int tileCount = tiling.getTiles(k, tiles);
+            for (unsigned int t = 0; t < tileCount; t++) {
+                const Tile &tile = tiles[t];
+                // a column of a tile is a contiguous run of the dist vector, for tiles below the diagonal it
+                // starts at rowBegin
+                if (tile.rowBegin >= tile.colEnd) {
+                    for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                        columns[j - tile.colBegin] = &output[matToVecIdx(j, tile.rowBegin, vecSize)];
+                    }
+                    distance->calcBlockDistances(observations.colptr(tile.rowBegin), tile.rowEnd - tile.rowBegin,
+                                                 observations.colptr(tile.colBegin), tile.colEnd - tile.colBegin,
+                                                 observations.n_rows, columns);
+                    continue;
+                }
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    uint64_t i = std::max(tile.rowBegin, j + 1);
+                    if (i >= tile.rowEnd) {
+                        continue;
+                    }
+                    distance->calcRowDistances(observations.colptr(i), tile.rowEnd - i, observations.colptr(j),
+                                               observations.n_rows, &output[matToVecIdx(j, i, vecSize)]);
+                }
+            }
+        }
+    }
+};
+
+// several binary measures of a matrix, the counts of a pair are taken once for all measures. T is the storage of
+// the packed words, double for packed rows of a matrix or uint32_t for packed integer and byte observations.
+template <typename T> struct BinaryMeasuresMatrixVec : public backend::Worker {
+    // packed input observations
+    const arma::Mat<T> &observations;
+
+    // number of elements of an observation before packing
+    uword len;
+
+    uint64_t vecSize;
+
+    // condensed output vectors, one per measure
+    const std::vector<double *> &outputs;
+
+    const std::vector<IBinaryMeasure *> &measures;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    BinaryMeasuresMatrixVec(const arma::Mat<T> &observations, uword len, const std::vector<double *> &outputs,
+                            const std::vector<IBinaryMeasure *> &measures, const TriangularTiling &tiling)
+        : observations(observations), len(len), vecSize(observations.n_cols), outputs(outputs), measures(measures),
+          tiling(tiling) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        for (std::size_t k = begin; k < end; k++) {
+            unsigned int tileCount = tiling.getTiles(k, tiles);
+            for (unsigned int t = 0; t < tileCount; t++) {
+                const Tile &tile = tiles[t];
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    for (uint64_t i = std::max(tile.rowBegin, j + 1); i < tile.rowEnd; i++) {
+                        BinaryCount bc = BinaryCount::getPackedBinaryCount(observations.colptr(i),
+                                                                           observations.colptr(j), len);
+                        uint64_t idx = matToVecIdx(j, i, vecSize);
+                        for (std::size_t m = 0; m < measures.size(); m++) {
+                            outputs[m][idx] = measures[m]->calcMeasure(bc, len);
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+// hamming distances of integer or byte observations (element type E) compared in their own width
+template <typename E> struct HammingMatrixVec : public backend::Worker {
+    // input observations, column i holds row i of the input matrix
+    const arma::Mat<E> &observations;
+
+    // whether an observation has no missing values
+    const std::vector<char> &complete;
+
+    // condensed output vector
+    double *output;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    HammingMatrixVec(const arma::Mat<E> &observations, const std::vector<char> &complete, double *output,
+                     const TriangularTiling &tiling)
+        : observations(observations), complete(complete), output(output), tiling(tiling) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        uword len = observations.n_rows;
+        for (std::size_t k = begin; k < end; k++) {
+            unsigned int tileCount = tiling.getTiles(k, tiles);
+            for (unsigned int t = 0; t < tileCount; t++) {
+                const Tile &tile = tiles[t];
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    for (uint64_t i = std::max(tile.rowBegin, j + 1); i < tile.rowEnd; i++) {
+                        output[matToVecIdx(j, i, observations.n_cols)] = elements::hamming(
+                            observations.colptr(i), observations.colptr(j), len, complete[i] || complete[j]);
+                    }
+                }
+            }
+        }
+    }
+};
+
+// copies the rows of a column-major n x dim matrix of element type E into contiguous observations and marks the
+// observations without missing values
+template <typename E> struct TransposeElements : public backend::Worker {
+    const E *data;
+    uint64_t n;
+
+    // observations as columns
+    arma::Mat<E> &observations;
+
+    // whether an observation has no missing values, true on entry
+    std::vector<char> &complete;
+
+    TransposeElements(const E *data, uint64_t n, arma::Mat<E> &observations, std::vector<char> &complete)
+        : data(data), n(n), observations(observations), complete(complete) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        for (uword c = 0; c < observations.n_rows; c++) {
+            const E *column = data + c * n;
+            for (std::size_t r = begin; r < end; r++) {
+                observations.at(c, r) = column[r];
+                if (elements::isMissing(column[r])) {
+                    complete[r] = false;
+                }
+            }
+        }
+    }
+};
+
+// packs the rows of a column-major n x dim matrix of element type E into bits like packed::pack, the words of an
+// observation are zero on entry
+template <typename E> struct PackElements : public backend::Worker {
+    const E *data;
+    uint64_t n;
+    uint64_t dim;
+
+    // packed observations as columns of 32-bit words
+    arma::Mat<uint32_t> &words;
+
+    PackElements(const E *data, uint64_t n, uint64_t dim, arma::Mat<uint32_t> &words)
+        : data(data), n(n), dim(dim), words(words) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        for (uword c = 0; c < dim; c++) {
+            const E *column = data + c * n;
+            uword word = c / 32, bit = c % 32;
+            for (std::size_t r = begin; r < end; r++) {
+                words.at(word, r) |= static_cast<uint32_t>(column[r] != 0) << bit;
+            }
+        }
+    }
+};
+
+// sparse observations, only their nonzero elements are visited
+struct SparseMatrixVec : public backend::Worker {
+    const SparseObservations &observations;
+
+    // condensed output vector
+    double *output;
+
+    ISparseDistance &distance;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    SparseMatrixVec(const SparseObservations &observations, double *output, ISparseDistance &distance,
+                    const TriangularTiling &tiling)
+        : observations(observations), output(output), distance(distance), tiling(tiling) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        for (std::size_t k = begin; k < end; k++) {
+            unsigned int tileCount = tiling.getTiles(k, tiles);
+            for (unsigned int t = 0; t < tileCount; t++) {
+                const Tile &tile = tiles[t];
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    SparseRow b(observations, j);
+                    for (uint64_t i = std::max(tile.rowBegin, j + 1); i < tile.rowEnd; i++) {
+                        output[matToVecIdx(j, i, observations.n)] =
+                            distance.calcDistance(SparseRow(observations, i), b, observations.len);
+                    }
+                }
+            }
+        }
+    }
+};
+
+// cross distances between the matrices of two lists
+struct CrossDistanceVec : public backend::Worker {
+    // input vectors of matrices
+    const std::vector<arma::mat> &xVec;
+    const std::vector<arma::mat> &yVec;
+
+    // column-major output matrix
+    double *output;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the cross distance matrix
+    const RectangularTiling &tiling;
+
+    CrossDistanceVec(const std::vector<arma::mat> &xVec, const std::vector<arma::mat> &yVec,
+                     double *output, const std::shared_ptr<IDistance> &distance, const RectangularTiling &tiling)
+        : xVec(xVec), yVec(yVec), output(output), distance(distance), tiling(tiling) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        uint64_t m = xVec.size();
+        for (std::size_t k = begin; k < end; k++) {
+            Tile tile = tiling.getTile(k);
+            for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                for (uint64_t i = tile.rowBegin; i < tile.rowEnd; i++) {
+                    output[j * m + i] = distance->calcDistance(xVec.at(i), yVec.at(j));
+                }
+            }
+        }
+    }
+};
+
+// cross distances between the rows of two matrices
+struct CrossDistanceMatrix : public backend::Worker {
+    // input observations, column i is a contiguous copy of row i of the input matrices
+    const arma::mat &xObservations;
+    const arma::mat &yObservations;
+
+    // column-major output matrix
+    double *output;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the cross distance matrix
+    const RectangularTiling &tiling;
+
+    CrossDistanceMatrix(const arma::mat &xObservations, const arma::mat &yObservations, double *output,
+                        const std::shared_ptr<IDistance> &distance, const RectangularTiling &tiling)
+        : xObservations(xObservations), yObservations(yObservations), output(output), distance(distance),
+          tiling(tiling) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        uint64_t m = xObservations.n_cols;
+        std::vector<double *> columns(tiling.getTileSize());
+        for (std::size_t k = begin; k < end; k++) {
+            Tile tile = tiling.getTile(k);
+            // a column of a tile is a contiguous run of the output matrix
+            for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                columns[j - tile.colBegin] = &output[j * m + tile.rowBegin];
+            }
+            distance->calcBlockDistances(xObservations.colptr(tile.rowBegin), tile.rowEnd - tile.rowBegin,
+                                         yObservations.colptr(tile.colBegin), tile.colEnd - tile.colBegin,
+                                         xObservations.n_rows, columns.data());
+        }
+    }
+};
+
+// k nearest neighbours of each matrix of a list
+struct NearestNeighboursVec : public backend::Worker {
+    // input vector of matrices
+    const std::vector<arma::mat> &seriesVec;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    // neighbours found by this body
+    uint64_t k;
+    NeighbourHeaps heaps;
+
+    NearestNeighboursVec(const std::vector<arma::mat> &seriesVec, const std::shared_ptr<IDistance> &distance,
+                         const TriangularTiling &tiling, uint64_t k)
+        : seriesVec(seriesVec), distance(distance), tiling(tiling), k(k), heaps(seriesVec.size(), k) {}
+
+    NearestNeighboursVec(const NearestNeighboursVec &other, backend::Split)
+        : seriesVec(other.seriesVec), distance(other.distance), tiling(other.tiling), k(other.k),
+          heaps(other.seriesVec.size(), other.k) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        for (std::size_t t = begin; t < end; t++) {
+            unsigned int tileCount = tiling.getTiles(t, tiles);
+            for (unsigned int c = 0; c < tileCount; c++) {
+                const Tile &tile = tiles[c];
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    for (uint64_t i = std::max(tile.rowBegin, j + 1); i < tile.rowEnd; i++) {
+                        double dist = distance->calcDistance(seriesVec.at(i), seriesVec.at(j));
+                        heaps.offer(i, j, dist);
+                        heaps.offer(j, i, dist);
+                    }
+                }
+            }
+        }
+    }
+
+    void join(const NearestNeighboursVec &other) {
+        heaps.merge(other.heaps);
+    }
+};
+
+// k nearest neighbours of each row of a matrix
+struct NearestNeighboursMatrix : public backend::Worker {
+    // input observations, column i is a contiguous copy of row i of the input matrix
+    const arma::mat &observations;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    // neighbours found by this body
+    uint64_t k;
+    NeighbourHeaps heaps;
+
+    NearestNeighboursMatrix(const arma::mat &observations, const std::shared_ptr<IDistance> &distance,
+                            const TriangularTiling &tiling, uint64_t k)
+        : observations(observations), distance(distance), tiling(tiling), k(k), heaps(observations.n_cols, k) {}
+
+    NearestNeighboursMatrix(const NearestNeighboursMatrix &other, backend::Split)
+        : observations(other.observations), distance(other.distance), tiling(other.tiling), k(other.k),
+          heaps(other.observations.n_cols, other.k) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        uint64_t tileSize = tiling.getTileSize();
+        // distances of one tile, stored by columns
+        std::vector<double> block(tileSize * tileSize);
+        std::vector<double *> columns(tileSize);
+        for (uint64_t c = 0; c < tileSize; c++) {
+            columns[c] = &block[c * tileSize];
+        }
+        for (std::size_t t = begin; t < end; t++) {
+            unsigned int tileCount = tiling.getTiles(t, tiles);
+            for (unsigned int c = 0; c < tileCount; c++) {
+                const Tile &tile = tiles[c];
+                if (!tile.isDiagonal()) {
+                    distance->calcBlockDistances(observations.colptr(tile.rowBegin), tile.rowEnd - tile.rowBegin,
+                                                 observations.colptr(tile.colBegin), tile.colEnd - tile.colBegin,
+                                                 observations.n_rows, columns.data());
+                }
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    uint64_t first = std::max(tile.rowBegin, j + 1);
+                    if (first >= tile.rowEnd) {
+                        continue;
+                    }
+                    const double *column = columns[j - tile.colBegin];
+                    if (tile.isDiagonal()) {
+                        // diagonal tiles are computed column by column into the start of the buffer
+                        column = &block[0];
+                        distance->calcRowDistances(observations.colptr(first), tile.rowEnd - first,
+                                                   observations.colptr(j), observations.n_rows, &block[0]);
+                    }
+                    for (uint64_t i = first; i < tile.rowEnd; i++) {
+                        double dist = column[i - first];
+                        heaps.offer(i, j, dist);
+                        heaps.offer(j, i, dist);
+                    }
+                }
+            }
+        }
+    }
+
+    void join(const NearestNeighboursMatrix &other) {
+        heaps.merge(other.heaps);
+    }
+};
+
+// k nearest reference matrices of each query matrix of a list
+struct QueryNeighboursVec : public backend::Worker {
+    // query and reference vectors of matrices
+    const std::vector<arma::mat> &xVec;
+    const std::vector<arma::mat> &yVec;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the query x reference matrix
+    const RectangularTiling &tiling;
+
+    // neighbours found by this body
+    uint64_t k;
+    NeighbourHeaps heaps;
+
+    QueryNeighboursVec(const std::vector<arma::mat> &xVec, const std::vector<arma::mat> &yVec,
+                       const std::shared_ptr<IDistance> &distance, const RectangularTiling &tiling, uint64_t k)
+        : xVec(xVec), yVec(yVec), distance(distance), tiling(tiling), k(k), heaps(xVec.size(), k) {}
+
+    QueryNeighboursVec(const QueryNeighboursVec &other, backend::Split)
+        : xVec(other.xVec), yVec(other.yVec), distance(other.distance), tiling(other.tiling), k(other.k),
+          heaps(other.xVec.size(), other.k) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; t++) {
+            Tile tile = tiling.getTile(t);
+            for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                for (uint64_t i = tile.rowBegin; i < tile.rowEnd; i++) {
+                    heaps.offer(i, j, distance->calcDistance(xVec.at(i), yVec.at(j)));
+                }
+            }
+        }
+    }
+
+    void join(const QueryNeighboursVec &other) {
+        heaps.merge(other.heaps);
+    }
+};
+
+// k nearest reference rows of each query row
+struct QueryNeighboursMatrix : public backend::Worker {
+    // query and reference observations, column i is a contiguous copy of row i of the input matrices
+    const arma::mat &xObservations;
+    const arma::mat &yObservations;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the query x reference matrix
+    const RectangularTiling &tiling;
+
+    // neighbours found by this body
+    uint64_t k;
+    NeighbourHeaps heaps;
+
+    QueryNeighboursMatrix(const arma::mat &xObservations, const arma::mat &yObservations,
+                          const std::shared_ptr<IDistance> &distance, const RectangularTiling &tiling, uint64_t k)
+        : xObservations(xObservations), yObservations(yObservations), distance(distance), tiling(tiling), k(k),
+          heaps(xObservations.n_cols, k) {}
+
+    QueryNeighboursMatrix(const QueryNeighboursMatrix &other, backend::Split)
+        : xObservations(other.xObservations), yObservations(other.yObservations), distance(other.distance),
+          tiling(other.tiling), k(other.k), heaps(other.xObservations.n_cols, other.k) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        uint64_t tileSize = tiling.getTileSize();
+        // distances of one tile, stored by columns
+        std::vector<double> block(tileSize * tileSize);
+        std::vector<double *> columns(tileSize);
+        for (uint64_t c = 0; c < tileSize; c++) {
+            columns[c] = &block[c * tileSize];
+        }
+        for (std::size_t t = begin; t < end; t++) {
+            Tile tile = tiling.getTile(t);
+            distance->calcBlockDistances(xObservations.colptr(tile.rowBegin), tile.rowEnd - tile.rowBegin,
+                                         yObservations.colptr(tile.colBegin), tile.colEnd - tile.colBegin,
+                                         xObservations.n_rows, columns.data());
+            for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                const double *column = columns[j - tile.colBegin];
+                for (uint64_t i = tile.rowBegin; i < tile.rowEnd; i++) {
+                    heaps.offer(i, j, column[i - tile.rowBegin]);
+                }
+            }
+        }
+    }
+
+    void join(const QueryNeighboursMatrix &other) {
+        heaps.merge(other.heaps);
+    }
+};
+
+// pairs of matrices of a list within a radius
+struct RadiusVec : public backend::Worker {
+    // input vector of matrices
+    const std::vector<arma::mat> &seriesVec;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    // pairs found by this body
+    double radius;
+    RadiusPairs pairs;
+
+    RadiusVec(const std::vector<arma::mat> &seriesVec, const std::shared_ptr<IDistance> &distance,
+              const TriangularTiling &tiling, double radius)
+        : seriesVec(seriesVec), distance(distance), tiling(tiling), radius(radius) {}
+
+    RadiusVec(const RadiusVec &other, backend::Split)
+        : seriesVec(other.seriesVec), distance(other.distance), tiling(other.tiling), radius(other.radius) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        for (std::size_t t = begin; t < end; t++) {
+            unsigned int tileCount = tiling.getTiles(t, tiles);
+            for (unsigned int c = 0; c < tileCount; c++) {
+                const Tile &tile = tiles[c];
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    for (uint64_t i = std::max(tile.rowBegin, j + 1); i < tile.rowEnd; i++) {
+                        double dist = distance->calcDistanceBounded(seriesVec.at(i), seriesVec.at(j), radius);
+                        if (dist <= radius) {
+                            pairs.add(i, j, dist);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void join(const RadiusVec &other) {
+        pairs.append(other.pairs);
+    }
+};
+
+// pairs of rows of a matrix within a radius
+struct RadiusMatrix : public backend::Worker {
+    // input observations, column i is a contiguous copy of row i of the input matrix
+    const arma::mat &observations;
+
+    // distance function
+    std::shared_ptr<IDistance> distance;
+
+    // tiles of the lower triangle
+    const TriangularTiling &tiling;
+
+    // pairs found by this body
+    double radius;
+    RadiusPairs pairs;
+
+    RadiusMatrix(const arma::mat &observations, const std::shared_ptr<IDistance> &distance,
+                 const TriangularTiling &tiling, double radius)
+        : observations(observations), distance(distance), tiling(tiling), radius(radius) {}
+
+    RadiusMatrix(const RadiusMatrix &other, backend::Split)
+        : observations(other.observations), distance(other.distance), tiling(other.tiling), radius(other.radius) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        Tile tiles[2];
+        uint64_t tileSize = tiling.getTileSize();
+        uint64_t len = observations.n_rows;
+        // distances of one tile, stored by columns
+        std::vector<double> block(tileSize * tileSize);
+        std::vector<double *> columns(tileSize);
+        for (uint64_t c = 0; c < tileSize; c++) {
+            columns[c] = &block[c * tileSize];
+        }
+        for (std::size_t t = begin; t < end; t++) {
+            unsigned int tileCount = tiling.getTiles(t, tiles);
+            for (unsigned int c = 0; c < tileCount; c++) {
+                const Tile &tile = tiles[c];
+                if (!tile.isDiagonal()) {
+                    distance->calcBlockDistancesBounded(
+                        observations.colptr(tile.rowBegin), tile.rowEnd - tile.rowBegin,
+                        observations.colptr(tile.colBegin), tile.colEnd - tile.colBegin, len, radius, columns.data());
+                }
+                for (uint64_t j = tile.colBegin; j < tile.colEnd; j++) {
+                    uint64_t first = std::max(tile.rowBegin, j + 1);
+                    if (first >= tile.rowEnd) {
+                        continue;
+                    }
+                    const double *column = columns[j - tile.colBegin];
+                    if (tile.isDiagonal()) {
+                        // diagonal tiles are computed column by column into the start of the buffer
+                        column = &block[0];
+                        distance->calcBlockDistancesBounded(observations.colptr(first), tile.rowEnd - first,
+                                                            observations.colptr(j), 1, len, radius, columns.data());
+                    }
+                    for (uint64_t i = first; i < tile.rowEnd; i++) {
+                        if (column[i - first] <= radius) {
+                            pairs.add(i, j, column[i - first]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void join(const RadiusMatrix &other) {
+        pairs.append(other.pairs);
+    }
+};
+
+// Calculates the condensed distance vector of a list of matrices into output, only the pairs with at least one
+// matrix from first on are calculated. Work items completed according to progress are skipped.
+template <typename T>
+void calcDistVec(const std::vector<arma::mat> &listVec, const std::shared_ptr<IDistance> &distanceFunction,
+                 T *output, uint64_t first, Progress &progress, Profile *profile) {
+    uint64_t n = listVec.size();
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, 0), first);
+    DistanceVec<T> distanceWorker(listVec, output, distanceFunction, tiling);
+    chunkedParallelFor(distanceWorker, tiling, progress, profile);
+}
+
+// Calculates the condensed distance vector of a list of matrices into output
+template <typename T>
+void calcDistVec(const std::vector<arma::mat> &listVec, const DistanceOptions &options, T *output,
+                 Progress &progress, Profile *profile) {
+    std::shared_ptr<IDistance> distanceFunction;
+    {
+        ProfilePhase phase(profile, "precomputation");
+        distanceFunction = DistanceFactory(listVec).createDistanceFunction(options);
+    }
+    calcDistVec(listVec, distanceFunction, output, 0, progress, profile);
+}
+
+// Prepared observations in the element type T, packed observations are copied bytewise instead of converted
+template <typename T> arma::Mat<T> typedObservations(const arma::mat &observations, IDistance &distanceFunction) {
+    if (sizeof(T) == sizeof(double) || !distanceFunction.packsObservations()) {
+        return arma::conv_to<arma::Mat<T>>::from(observations);
+    }
+    arma::Mat<T> packedObservations(observations.n_rows, observations.n_cols);
+    for (uword k = 0; k < observations.n_cols; k++) {
+        std::memcpy(packedObservations.colptr(k), observations.colptr(k), observations.n_rows * sizeof(T));
+    }
+    return packedObservations;
+}
+
+// Calculates the condensed distance vector of the rows of a matrix into output, only the pairs with at least
+// one row from first on are calculated. Work items completed according to progress are skipped. The distances
+// are computed in the precision of the output.
+template <typename T>
+void calcDistMatrix(const arma::mat &dataMatrix, const std::shared_ptr<IDistance> &distanceFunction, T *output,
+                    uint64_t first, Progress &progress, Profile *profile) {
+    uint64_t n = dataMatrix.n_rows;
+    arma::Mat<T> observations;
+    {
+        ProfilePhase phase(profile, "transpose");
+        // transpose once, so every observation is contiguous in memory
+        observations = typedObservations<T>(rowObservations(dataMatrix, *distanceFunction), *distanceFunction);
+        phase.allocated(observations.n_elem * sizeof(T));
+    }
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, dataMatrix.n_cols * sizeof(T)), first);
+    DistanceMatrixVec<T> distanceWorker(observations, output, distanceFunction, tiling);
+    chunkedParallelFor(distanceWorker, tiling, progress, profile);
+}
+
+// Calculates the condensed distance vector of the rows of a matrix into output
+template <typename T>
+void calcDistMatrix(const arma::mat &dataMatrix, const DistanceOptions &options, T *output, Progress &progress,
+                    Profile *profile) {
+    std::shared_ptr<IDistance> distanceFunction;
+    {
+        ProfilePhase phase(profile, "precomputation");
+        distanceFunction = DistanceFactory(dataMatrix).createDistanceFunction(options);
+    }
+    calcDistMatrix(dataMatrix, distanceFunction, output, 0, progress, profile);
+}
+
+
+template void calcDistVec<double>(const std::vector<arma::mat> &, const std::shared_ptr<IDistance> &, double *,
+                                  uint64_t, Progress &, Profile *);
+template void calcDistVec<float>(const std::vector<arma::mat> &, const std::shared_ptr<IDistance> &, float *,
+                                 uint64_t, Progress &, Profile *);
+template void calcDistVec<double>(const std::vector<arma::mat> &, const DistanceOptions &, double *, Progress &,
+                                  Profile *);
+template void calcDistVec<float>(const std::vector<arma::mat> &, const DistanceOptions &, float *, Progress &,
+                                 Profile *);
+template void calcDistMatrix<double>(const arma::mat &, const std::shared_ptr<IDistance> &, double *, uint64_t,
+                                     Progress &, Profile *);
+template void calcDistMatrix<float>(const arma::mat &, const std::shared_ptr<IDistance> &, float *, uint64_t,
+                                    Progress &, Profile *);
+template void calcDistMatrix<double>(const arma::mat &, const DistanceOptions &, double *, Progress &, Profile *);
+template void calcDistMatrix<float>(const arma::mat &, const DistanceOptions &, float *, Progress &, Profile *);
+
+void calcBinaryDistMatrix(const arma::mat &dataMatrix, const std::vector<DistanceOptions> &options,
+                          const std::vector<double *> &outputs, Progress &progress) {
+    uint64_t n = dataMatrix.n_rows;
+    std::vector<std::shared_ptr<IDistance>> distanceFunctions;
+    std::vector<IBinaryMeasure *> measures;
+    for (std::size_t m = 0; m < options.size(); m++) {
+        distanceFunctions.push_back(DistanceFactory(dataMatrix).createDistanceFunction(options[m]));
+        IBinaryMeasure *measure = dynamic_cast<IBinaryMeasure *>(distanceFunctions.back().get());
+        if (measure == NULL) {
+            throw std::invalid_argument("Only binary distance measures can be calculated together.");
+        }
+        measures.push_back(measure);
+    }
+    if (measures.empty()) {
+        return;
+    }
+    // all binary measures pack their observations alike
+    arma::mat observations = rowObservations(dataMatrix, *distanceFunctions.front());
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, (dataMatrix.n_cols + 7) / 8));
+    BinaryMeasuresMatrixVec<double> distanceWorker(observations, dataMatrix.n_cols, outputs, measures, tiling);
+    chunkedParallelFor(distanceWorker, tiling, progress);
+}
+
+void calcDistSparse(SparseObservations &observations, const DistanceOptions &options, double *output,
+                    Progress &progress) {
+    std::shared_ptr<ISparseDistance> distanceFunction = DistanceSparseFactory().createDistanceFunction(options);
+    for (uword k = 0; k < observations.n; k++) {
+        distanceFunction->prepare(observations.values.data() + observations.offsets[k],
+                                  observations.offsets[k + 1] - observations.offsets[k]);
+    }
+    uint64_t n = observations.n;
+    // average memory of the nonzero elements of an observation
+    uint64_t bytesPerObservation =
+        observations.values.size() * (sizeof(double) + sizeof(uword)) / std::max<uint64_t>(n, 1);
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, bytesPerObservation));
+    SparseMatrixVec distanceWorker(observations, output, *distanceFunction, tiling);
+    chunkedParallelFor(distanceWorker, tiling, progress);
+}
+
+// Runs a worker over the n observations of an input matrix, small inputs on the calling thread
+template <typename Worker> void runObservations(uint64_t n, uint64_t work, Worker &worker) {
+    if (work <= serialWork) {
+        worker(0, n);
+    } else {
+        backend::parallelFor(0, n, worker, 64);
+    }
+}
+
+template <typename E>
+void calcDistElements(const E *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                      Progress &progress) {
+    bool pairwise = util::isEqualStr(options.engine, "pairwise");
+    if (pairwise && util::isEqualStr(options.method, "hamming")) {
+        arma::Mat<E> observations(dim, n);
+        std::vector<char> complete(n, true);
+        TransposeElements<E> transposeWorker(data, n, observations, complete);
+        runObservations(n, n * dim, transposeWorker);
+        TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, dim * sizeof(E)));
+        HammingMatrixVec<E> distanceWorker(observations, complete, output, tiling);
+        chunkedParallelFor(distanceWorker, tiling, progress);
+        return;
+    }
+    std::shared_ptr<IDistance> binaryMeasure = pairwise ? createBinaryMeasure(options.method, false) : NULL;
+    if (binaryMeasure != NULL) {
+        arma::Mat<uint32_t> words(packed::wordCount(dim), n);
+        words.zeros();
+        PackElements<E> packWorker(data, n, dim, words);
+        runObservations(n, n * dim, packWorker);
+        std::vector<IBinaryMeasure *> measures(1, dynamic_cast<IBinaryMeasure *>(binaryMeasure.get()));
+        std::vector<double *> outputs(1, output);
+        TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, words.n_rows * sizeof(uint32_t)));
+        BinaryMeasuresMatrixVec<uint32_t> distanceWorker(words, dim, outputs, measures, tiling);
+        chunkedParallelFor(distanceWorker, tiling, progress);
+        return;
+    }
+    // the other methods take the values in double precision
+    arma::mat dataMatrix(n, dim);
+    for (uword k = 0; k < dataMatrix.n_elem; k++) {
+        dataMatrix[k] = elements::widen(data[k]);
+    }
+    calcDistMatrix(dataMatrix, options, output, progress);
+}
+
+template void calcDistElements<int32_t>(const int32_t *, uint64_t, uint64_t, const DistanceOptions &, double *,
+                                        Progress &);
+template void calcDistElements<uint8_t>(const uint8_t *, uint64_t, uint64_t, const DistanceOptions &, double *,
+                                        Progress &);
+
+// Copies the condensed distances of n observations into the condensed vector of the first n of m observations.
+// Column j of the existing distances stays contiguous, it is followed by the distances to the appended rows.
+void copyDistances(const double *distances, uint64_t n, double *output, uint64_t m) {
+    for (uint64_t j = 0; j + 1 < n; j++) {
+        const double *column = &distances[matToVecIdx(j, j + 1, n)];
+        std::copy(column, column + (n - j - 1), &output[matToVecIdx(j, j + 1, m)]);
+    }
+}
+
+arma::mat rowObservations(const arma::mat &dataMatrix, IDistance &distanceFunction) {
+    arma::mat observations = dataMatrix.t();
+    if (distanceFunction.preparesObservations()) {
+        PrepareObservations prepareWorker(observations, distanceFunction);
+        if (observations.n_elem <= serialWork) {
+            prepareWorker(0, observations.n_cols);
+        } else {
+            backend::parallelFor(0, observations.n_cols, prepareWorker, 64);
+        }
+    }
+    return observations;
+}
+
+// Small calculations run on the calling thread, where starting a parallel loop costs more than the work
+template <typename Worker> void runTiles(uint64_t tiles, uint64_t work, Worker &worker) {
+    if (tiles <= 1 || work <= serialWork) {
+        worker(0, tiles);
+    } else {
+        backend::parallelFor(0, tiles, worker, 1);
+    }
+}
+
+template <typename Reducer> void reduceTiles(uint64_t tiles, uint64_t work, Reducer &reducer) {
+    if (tiles <= 1 || work <= serialWork) {
+        reducer(0, tiles);
+    } else {
+        backend::parallelReduce(0, tiles, reducer, 1);
+    }
+}
+
+// tiling of the cross distances between m and n observations of len elements (0 for matrices of a list)
+inline RectangularTiling crossTiling(uint64_t m, uint64_t n, uint64_t len) {
+    return RectangularTiling(m, n, TriangularTiling::tileSizeFor(std::max(m, n), len * sizeof(double)));
+}
+
+void calcCrossDistMatrix(const arma::mat &xMatrix, const arma::mat &yMatrix,
+                         const std::shared_ptr<IDistance> &distanceFunction, double *output) {
+    arma::mat xObservations = rowObservations(xMatrix, *distanceFunction);
+    arma::mat yObservations = rowObservations(yMatrix, *distanceFunction);
+    calcCrossDistObservations(xObservations, yObservations, distanceFunction, output);
+}
+
+void calcCrossDistObservations(const arma::mat &xObservations, const arma::mat &yObservations,
+                               const std::shared_ptr<IDistance> &distanceFunction, double *output) {
+    RectangularTiling tiling = crossTiling(xObservations.n_cols, yObservations.n_cols, xObservations.n_rows);
+    CrossDistanceMatrix distanceWorker(xObservations, yObservations, output, distanceFunction, tiling);
+    runTiles(tiling.size(), xObservations.n_elem * yObservations.n_cols, distanceWorker);
+}
+
+void calcCrossDistVec(const std::vector<arma::mat> &xVec, const std::vector<arma::mat> &yVec,
+                      const std::shared_ptr<IDistance> &distanceFunction, double *output) {
+    RectangularTiling tiling = crossTiling(xVec.size(), yVec.size(), 0);
+    CrossDistanceVec distanceWorker(xVec, yVec, output, distanceFunction, tiling);
+    backend::parallelFor(0, tiling.size(), distanceWorker, 1);
+}
+
+NeighbourHeaps calcQueryKnnObservations(const arma::mat &xObservations, const arma::mat &yObservations,
+                                        const std::shared_ptr<IDistance> &distanceFunction, uint64_t k) {
+    RectangularTiling tiling = crossTiling(xObservations.n_cols, yObservations.n_cols, xObservations.n_rows);
+    QueryNeighboursMatrix knnWorker(xObservations, yObservations, distanceFunction, tiling, k);
+    reduceTiles(tiling.size(), xObservations.n_elem * yObservations.n_cols, knnWorker);
+    return knnWorker.heaps;
+}
+
+NeighbourHeaps calcQueryKnnVec(const std::vector<arma::mat> &xVec, const std::vector<arma::mat> &yVec,
+                               const std::shared_ptr<IDistance> &distanceFunction, uint64_t k) {
+    RectangularTiling tiling = crossTiling(xVec.size(), yVec.size(), 0);
+    QueryNeighboursVec knnWorker(xVec, yVec, distanceFunction, tiling, k);
+    backend::parallelReduce(0, tiling.size(), knnWorker, 1);
+    return knnWorker.heaps;
+}
+
+NeighbourHeaps calcKnnMatrix(const arma::mat &dataMatrix, const std::shared_ptr<IDistance> &distanceFunction,
+                             uint64_t k) {
+    uint64_t n = dataMatrix.n_rows;
+    arma::mat observations = rowObservations(dataMatrix, *distanceFunction);
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, dataMatrix.n_cols * sizeof(double)));
+    NearestNeighboursMatrix knnWorker(observations, distanceFunction, tiling, k);
+    backend::parallelReduce(0, tiling.size(), knnWorker, 1);
+    return knnWorker.heaps;
+}
+
+NeighbourHeaps calcKnnVec(const std::vector<arma::mat> &listVec, const std::shared_ptr<IDistance> &distanceFunction,
+                          uint64_t k) {
+    uint64_t n = listVec.size();
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, 0));
+    NearestNeighboursVec knnWorker(listVec, distanceFunction, tiling, k);
+    backend::parallelReduce(0, tiling.size(), knnWorker, 1);
+    return knnWorker.heaps;
+}
+
+RadiusPairs calcRadiusMatrix(const arma::mat &dataMatrix, const std::shared_ptr<IDistance> &distanceFunction,
+                             double radius) {
+    uint64_t n = dataMatrix.n_rows;
+    arma::mat observations = rowObservations(dataMatrix, *distanceFunction);
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, dataMatrix.n_cols * sizeof(double)));
+    RadiusMatrix radiusWorker(observations, distanceFunction, tiling, radius);
+    backend::parallelReduce(0, tiling.size(), radiusWorker, 1);
+    return radiusWorker.pairs;
+}
+
+RadiusPairs calcRadiusVec(const std::vector<arma::mat> &listVec, const std::shared_ptr<IDistance> &distanceFunction,
+                          double radius) {
+    uint64_t n = listVec.size();
+    TriangularTiling tiling(n, TriangularTiling::tileSizeFor(n, 0));
+    RadiusVec radiusWorker(listVec, distanceFunction, tiling, radius);
+    backend::parallelReduce(0, tiling.size(), radiusWorker, 1);
+    return radiusWorker.pairs;
+}
+
+//------------------------------
+// Raw memory interface
+//------------------------------
+
+// column-major matrix using the memory of data
+inline arma::mat borrowMatrix(const double *data, uint64_t rows, uint64_t cols) {
+    return arma::mat(const_cast<double *>(data), rows, cols, false, true);
+}
+
+template <typename T>
+void parallelDistImpl(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options, T *output,
+                      Progress *progress) {
+    Progress noProgress;
+    calcDistMatrix(borrowMatrix(data, n, dim), options, output, progress != NULL ? *progress : noProgress);
+}
+
+void parallelDist(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                  Progress *progress) {
+    parallelDistImpl(data, n, dim, options, output, progress);
+}
+
+void parallelDist(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options, float *output,
+                  Progress *progress) {
+    parallelDistImpl(data, n, dim, options, output, progress);
+}
+
+void parallelDist(const int32_t *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                  Progress *progress) {
+    Progress noProgress;
+    calcDistElements(data, n, dim, options, output, progress != NULL ? *progress : noProgress);
+}
+
+void parallelDist(const uint8_t *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                  Progress *progress) {
+    Progress noProgress;
+    calcDistElements(data, n, dim, options, output, progress != NULL ? *progress : noProgress);
+}
+
+void parallelBinaryDist(const double *data, uint64_t n, uint64_t dim, const std::vector<std::string> &methods,
+                        const std::vector<double *> &outputs, Progress *progress) {
+    std::vector<DistanceOptions> options;
+    for (std::size_t m = 0; m < methods.size(); m++) {
+        options.push_back(DistanceOptions(methods[m]));
+    }
+    Progress noProgress;
+    calcBinaryDistMatrix(borrowMatrix(data, n, dim), options, outputs, progress != NULL ? *progress : noProgress);
+}
+
+void parallelDistSparse(uint64_t n, uint64_t dim, const int *columnOffsets, const int *rows, const double *x,
+                        const DistanceOptions &options, double *output, Progress *progress) {
+    SparseObservations observations = SparseObservations::fromColumns(n, dim, columnOffsets, rows, x);
+    Progress noProgress;
+    calcDistSparse(observations, options, output, progress != NULL ? *progress : noProgress);
+}
+
+void parallelCrossDist(const double *x, uint64_t m, const double *y, uint64_t n, uint64_t dim,
+                       const DistanceOptions &options, double *output) {
+    arma::mat yMatrix = borrowMatrix(y, n, dim);
+    std::shared_ptr<IDistance> distanceFunction = DistanceFactory(yMatrix).createDistanceFunction(options);
+    calcCrossDistMatrix(borrowMatrix(x, m, dim), yMatrix, distanceFunction, output);
+}
+
+NeighbourHeaps parallelKnn(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options,
+                           uint64_t k) {
+    arma::mat dataMatrix = borrowMatrix(data, n, dim);
+    return calcKnnMatrix(dataMatrix, DistanceFactory(dataMatrix).createDistanceFunction(options), k);
+}
+
+RadiusPairs parallelRadius(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options,
+                           double radius) {
+    arma::mat dataMatrix = borrowMatrix(data, n, dim);
+    return calcRadiusMatrix(dataMatrix, DistanceFactory(dataMatrix).createDistanceFunction(options), radius);
+}
@@ -0,0 +1,251 @@
+// DistanceCore.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISTANCECORE_H_
+#define DISTANCECORE_H_
+
+#include "CoreBackend.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DistanceOptions.h"
+#include "DistanceSparse.h"
+#include "IDistance.h"
+#include "NeighbourHeaps.h"
+#include "ParallelChunks.h"
+#include "Profile.h"
+
+//==============================
+// Distance core
+//==============================
+// Tiled parallel distance calculations without R. Observations are the rows of a column-major matrix or the
+// matrices of a list, condensed outputs hold the lower triangle by columns like a dist object of R. The R
+// interface in parallelDist.cpp only converts its arguments and results.
+
+inline uint64_t sumForm(const uint64_t n) {
+    return ((n * n) + n) / 2;
+}
+
+// index of the pair (i, j) with i < j in the condensed vector of N observations
+inline uint64_t matToVecIdx(const uint64_t i, const uint64_t j, const uint64_t N) {
+    return i * N - i - sumForm(i) - 1 + j;
+}
+
+// pairs within a radius, collected per reduction body
+struct RadiusPairs {
+    // index of the observation with the larger index
+    std::vector<uint64_t> rows;
+    // index of the observation with the smaller index
+    std::vector<uint64_t> cols;
+    std::vector<double> distances;
+
+    inline void add(uint64_t row, uint64_t col, double distance) {
+        rows.push_back(row);
+        cols.push_back(col);
+        distances.push_back(distance);
+    }
+
+    void append(const RadiusPairs &other) {
+        rows.insert(rows.end(), other.rows.begin(), other.rows.end());
+        cols.insert(cols.end(), other.cols.begin(), other.cols.end());
+        distances.insert(distances.end(), other.distances.begin(), other.distances.end());
+    }
+};
+
+
+// Rows of a matrix as contiguous columns, prepared in parallel for the row distances of distanceFunction
+arma::mat rowObservations(const arma::mat &dataMatrix, IDistance &distanceFunction);
+
+// Condensed distance vector of a list of matrices (element type T is double or float), only the pairs with at
+// least one matrix from first on are calculated. Work items completed according to progress are skipped.
+template <typename T>
+void calcDistVec(const std::vector<arma::mat> &listVec, const std::shared_ptr<IDistance> &distanceFunction,
+                 T *output, uint64_t first, Progress &progress, Profile *profile = NULL);
+
+template <typename T>
+void calcDistVec(const std::vector<arma::mat> &listVec, const DistanceOptions &options, T *output,
+                 Progress &progress, Profile *profile = NULL);
+
+// Condensed distance vector of the rows of a matrix, computed in the precision T of the output (double or
+// float), only the pairs with at least one row from first on are calculated. Work items completed according to
+// progress are skipped.
+template <typename T>
+void calcDistMatrix(const arma::mat &dataMatrix, const std::shared_ptr<IDistance> &distanceFunction, T *output,
+                    uint64_t first, Progress &progress, Profile *profile = NULL);
+
+template <typename T>
+void calcDistMatrix(const arma::mat &dataMatrix, const DistanceOptions &options, T *output, Progress &progress,
+                    Profile *profile = NULL);
+
+// Condensed distance vectors of several binary measures of the rows of a matrix, outputs[m] receives the
+// distances of options[m]. The contingency counts of a pair are taken once for all measures.
+void calcBinaryDistMatrix(const arma::mat &dataMatrix, const std::vector<DistanceOptions> &options,
+                          const std::vector<double *> &outputs, Progress &progress);
+
+// Condensed distance vector of the rows of a column-major n x dim matrix of 32-bit integers or bytes (element type
+// E is int32_t or uint8_t), read in their own width. Hamming and binary distance measures compare the elements
+// directly, the other methods take the values widened to double precision.
+template <typename E>
+void calcDistElements(const E *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                      Progress &progress);
+
+// Condensed distance vector of sparse observations, their values are prepared in place for the method of options.
+// Pairs of zero elements are skipped.
+void calcDistSparse(SparseObservations &observations, const DistanceOptions &options, double *output,
+                    Progress &progress);
+
+// Copies the condensed distances of n observations into the condensed vector of the first n of m observations
+void copyDistances(const double *distances, uint64_t n, double *output, uint64_t m);
+
+// Cross distances between the rows of x and y into the column-major x.n_rows x y.n_rows output
+void calcCrossDistMatrix(const arma::mat &xMatrix, const arma::mat &yMatrix,
+                         const std::shared_ptr<IDistance> &distanceFunction, double *output);
+
+// Cross distances between observations stored as columns (see rowObservations) into the column-major
+// xObservations.n_cols x yObservations.n_cols output
+void calcCrossDistObservations(const arma::mat &xObservations, const arma::mat &yObservations,
+                               const std::shared_ptr<IDistance> &distanceFunction, double *output);
+
+// Cross distances between the matrices of two lists into the column-major output
+void calcCrossDistVec(const std::vector<arma::mat> &xVec, const std::vector<arma::mat> &yVec,
+                      const std::shared_ptr<IDistance> &distanceFunction, double *output);
+
+// k nearest neighbours of each row of a matrix
+NeighbourHeaps calcKnnMatrix(const arma::mat &dataMatrix, const std::shared_ptr<IDistance> &distanceFunction,
+                             uint64_t k);
+
+// k nearest neighbours of each matrix of a list
+NeighbourHeaps calcKnnVec(const std::vector<arma::mat> &listVec, const std::shared_ptr<IDistance> &distanceFunction,
+                          uint64_t k);
+
+// k nearest reference observations (columns of yObservations) of each query observation (columns of
+// xObservations), both prepared by rowObservations
+NeighbourHeaps calcQueryKnnObservations(const arma::mat &xObservations, const arma::mat &yObservations,
+                                        const std::shared_ptr<IDistance> &distanceFunction, uint64_t k);
+
+// k nearest reference matrices of yVec of each query matrix of xVec
+NeighbourHeaps calcQueryKnnVec(const std::vector<arma::mat> &xVec, const std::vector<arma::mat> &yVec,
+                               const std::shared_ptr<IDistance> &distanceFunction, uint64_t k);
+
+// pairs of rows of a matrix within a radius, in no particular order
+RadiusPairs calcRadiusMatrix(const arma::mat &dataMatrix, const std::shared_ptr<IDistance> &distanceFunction,
+                             double radius);
+
+// pairs of matrices of a list within a radius, in no particular order
+RadiusPairs calcRadiusVec(const std::vector<arma::mat> &listVec, const std::shared_ptr<IDistance> &distanceFunction,
+                          double radius);
+
+//------------------------------
+// Raw memory interface
+//------------------------------
+// Entry points for embedding, data is a column-major n x dim matrix of n observations. The memory is used in
+// place, the factory precalculations (like the covariance matrix of mahalanobis) are based on data. Errors are
+// reported as std::exception, an interrupt of the optional progress record ends the calculation.
+
+/**
+ Condensed distance vector of the rows of data
+ @param data column-major n x dim matrix
+ @param n number of observations
+ @param dim number of dimensions
+ @param options distance method and arguments
+ @param output n * (n - 1) / 2 distances
+ @param progress optional progress record
+ */
+void parallelDist(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                  Progress *progress = NULL);
+
+// single precision variant of parallelDist
+void parallelDist(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options, float *output,
+                  Progress *progress = NULL);
+
+// integer variant of parallelDist, the smallest int32_t marks a missing value like NA of R
+void parallelDist(const int32_t *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                  Progress *progress = NULL);
+
+// byte variant of parallelDist
+void parallelDist(const uint8_t *data, uint64_t n, uint64_t dim, const DistanceOptions &options, double *output,
+                  Progress *progress = NULL);
+
+/**
+ Condensed distance vectors of several binary measures of the rows of data, computed in a single pass
+ @param data column-major n x dim matrix
+ @param n number of observations
+ @param dim number of dimensions
+ @param methods names of binary distance measures
+ @param outputs n * (n - 1) / 2 distances for each method
+ @param progress optional progress record
+ */
+void parallelBinaryDist(const double *data, uint64_t n, uint64_t dim, const std::vector<std::string> &methods,
+                        const std::vector<double *> &outputs, Progress *progress = NULL);
+
+/**
+ Condensed distance vector of the rows of a sparse matrix given by its compressed sparse columns
+ @param n number of observations (rows)
+ @param dim number of dimensions (columns)
+ @param columnOffsets dim + 1 offsets of the columns into rows and x
+ @param rows row of each stored element, ascending within a column
+ @param x value of each stored element
+ @param options distance method and arguments
+ @param output n * (n - 1) / 2 distances
+ @param progress optional progress record
+ */
+void parallelDistSparse(uint64_t n, uint64_t dim, const int *columnOffsets, const int *rows, const double *x,
+                        const DistanceOptions &options, double *output, Progress *progress = NULL);
+
+/**
+ Cross distances between the rows of x and y, precalculations are based on the reference observations y
+ @param x column-major m x dim matrix
+ @param m number of observations of x
+ @param y column-major n x dim matrix
+ @param n number of observations of y
+ @param dim number of dimensions
+ @param options distance method and arguments
+ @param output column-major m x n matrix
+ */
+void parallelCrossDist(const double *x, uint64_t m, const double *y, uint64_t n, uint64_t dim,
+                       const DistanceOptions &options, double *output);
+
+/**
+ k nearest neighbours of each row of data
+ @param data column-major n x dim matrix
+ @param n number of observations
+ @param dim number of dimensions
+ @param options distance method and arguments
+ @param k number of neighbours
+ @return neighbours of every observation
+ */
+NeighbourHeaps parallelKnn(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options,
+                           uint64_t k);
+
+/**
+ Pairs of rows of data within a radius
+ @param data column-major n x dim matrix
+ @param n number of observations
+ @param dim number of dimensions
+ @param options distance method and arguments
+ @param radius largest distance of a pair
+ @return pairs in no particular order
+ */
+RadiusPairs parallelRadius(const double *data, uint64_t n, uint64_t dim, const DistanceOptions &options,
+                           double radius);
+
+#endif // DISTANCECORE_H_
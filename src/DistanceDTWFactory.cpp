@@ -21,32 +21,22 @@
 #include "StepPattern.h"
 #include "Util.h"
 
-std::shared_ptr<IDistance> DistanceDTWFactory::createDistanceFunction(
-    const std::string &distName, const Rcpp::List &arguments) {
+std::shared_ptr<IDistance> DistanceDTWFactory::createDistanceFunction(const DistanceOptions &options) {
     using util::isEqualStr;
 
     std::shared_ptr<IDistance> distanceFunction = NULL;
-    unsigned int windowSize = 0;
+    unsigned int windowSize = options.windowSize;
     NormMethod normMethod = NormMethod::NoNorm;
-    bool warpingWindow = false;
-    std::string stepPatternName = "symmetric1";
+    bool warpingWindow = options.warpingWindow;
+    const std::string &stepPatternName = options.stepPattern;
 
-    warpingWindow = arguments.containsElementNamed("window.size");
-    if (warpingWindow) {
-        windowSize = Rcpp::as<unsigned int>(arguments["window.size"]);
-    }
-    if (arguments.containsElementNamed("norm.method")) {
-        std::string normMethodStr = Rcpp::as<std::string>(arguments["norm.method"]);
-        if (isEqualStr(normMethodStr, "n")) {
-            normMethod = NormMethod::ALength;
-        } else if (isEqualStr(normMethodStr, "n+m")) {
-            normMethod = NormMethod::ABLength;
-        } else if (isEqualStr(normMethodStr, "path.length")) {
-            normMethod = NormMethod::PathLength;
-        }
-    }
-    if (arguments.containsElementNamed("step.pattern")) {
-        stepPatternName = Rcpp::as<std::string>(arguments["step.pattern"]);
+    const std::string &normMethodStr = options.normMethod;
+    if (isEqualStr(normMethodStr, "n")) {
+        normMethod = NormMethod::ALength;
+    } else if (isEqualStr(normMethodStr, "n+m")) {
+        normMethod = NormMethod::ABLength;
+    } else if (isEqualStr(normMethodStr, "path.length")) {
+        normMethod = NormMethod::PathLength;
     }
 
     if (isEqualStr(stepPatternName, "asymmetric")) {
@@ -20,16 +20,16 @@
 #ifndef DISTANCEDTWFACTORY_H_
 #define DISTANCEDTWFACTORY_H_
 
+#include "DistanceOptions.h"
 #include "IDistance.h"
 #include <memory>
-#include <string>
 
 //==============================
 // Distance DTW Factory
 //==============================
 class DistanceDTWFactory {
   public:
-    std::shared_ptr<IDistance> createDistanceFunction(const std::string &distName, const Rcpp::List &arguments);
+    std::shared_ptr<IDistance> createDistanceFunction(const DistanceOptions &options);
 };
 
 #endif // DISTANCEDTWFACTORY_H_
@@ -23,6 +23,7 @@
 #include "IDistance.h"
 #include <algorithm>
 #include <utility>
+#include <vector>
 
 #define min(x, y) ((x) < (y) ? (x) : (y))
 #define max(x, y) ((x) < (y) ? (y) : (x))
@@ -107,6 +108,10 @@ class DistanceDTWGeneric : public IDistance {
     }
 
     double calcDistance(const arma::mat &A, const arma::mat &B) {
+        return calcDistanceBounded(A, B, INFINITY);
+    }
+
+    double calcDistanceBounded(const arma::mat &A, const arma::mat &B, double bound) {
         const unsigned int patternOffset = getPatternOffset();
         // vector sizes for convenience
         const unsigned int Asize = A.n_cols, Bsize = B.n_cols;
@@ -131,6 +136,19 @@ class DistanceDTWGeneric : public IDistance {
             }
         }
 
+        // Costs never decrease along a warping path and every path to the end passes one of the last patternOffset
+        // rows, so the calculation is abandoned once the minima of these rows exceed the bound. The bound is
+        // scaled to unnormalized costs, warping path lengths are unknown until the end.
+        double costBound = bound;
+        if (normalizationMethod == NormMethod::PathLength) {
+            costBound = INFINITY;
+        } else if (normalizationMethod == NormMethod::ABLength) {
+            costBound *= Asize + Bsize;
+        } else if (normalizationMethod == NormMethod::ALength) {
+            costBound *= Asize;
+        }
+        std::vector<double> recentRowMinima(patternOffset, INFINITY);
+
         // adjust window if needed
         unsigned int effectiveWindowSize;
         if (warpingWindow) {
@@ -158,6 +176,21 @@ class DistanceDTWGeneric : public IDistance {
                     }
                 }
             }
+
+            if (costBound < INFINITY) {
+                double rowMinimum = INFINITY;
+                for (unsigned int j = lower; j < upper; ++j) {
+                    rowMinimum = min(rowMinimum, pen[currIdx + j]);
+                }
+                recentRowMinima[i % patternOffset] = rowMinimum;
+                if (*std::min_element(recentRowMinima.begin(), recentRowMinima.end()) > costBound) {
+                    delete[] pen;
+                    if (normalizationMethod == NormMethod::PathLength) {
+                        delete[] pre;
+                    }
+                    return INFINITY;
+                }
+            }
         }
 
         // remember the optimal distance measure
@@ -20,56 +20,75 @@
 #ifndef DISTANCEDIST_H_
 #define DISTANCEDIST_H_
 
+#include <algorithm>
 #include <limits>
+#include <vector>
 
+#include "DistanceGramKernel.h"
+#include "DistanceRowKernel.h"
 #include "IDistance.h"
 #include "Util.h"
 
 //=======================
 // Bhjattacharyya
 //=======================
-class DistanceBhjattacharyya : public IDistance {
+class DistanceBhjattacharyya : public DistanceRowKernel<DistanceBhjattacharyya> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // sqrt(sum_i (sqrt(x_i) - sqrt(y_i))^2))
         return std::sqrt(arma::accu(arma::square(arma::sqrt(A) - arma::sqrt(B))));
     }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            T diff = std::sqrt(a[i]) - std::sqrt(b[i]);
+            sum += diff * diff;
+        }
+        return std::sqrt(sum);
+    }
 };
 
 //=======================
 // Bray
 //=======================
-class DistanceBray : public IDistance {
+class DistanceBray : public DistanceRowKernel<DistanceBray> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // sum_i |x_i - y_i| / sum_i (x_i + y_i)
-        return arma::accu(arma::abs(A - B)) / arma::accu(A + B);
+        return elementwiseDistance(A, B);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T numerator = 0, denominator = 0;
+        for (uword i = 0; i < len; ++i) {
+            numerator += std::abs(a[i] - b[i]);
+            denominator += a[i] + b[i];
+        }
+        return numerator / denominator;
     }
 };
 
 //=======================
 // Canberra distance
 //=======================
-class DistanceCanberra : public IDistance {
+class DistanceCanberra : public DistanceRowKernel<DistanceCanberra> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
-        arma::mat denominator = arma::abs(A + B);
-        arma::mat ratio = arma::abs(A - B) / denominator;
-
-        unsigned int notNanCount = 0;
-        for (arma::mat::iterator it = ratio.begin(); it != ratio.end(); ++it) {
-            if (std::isnan(*it)) {
-                (*it) = 0.0;
-            } else {
-                ++notNanCount;
-            }
+        // sum_i |x_i - y_i| / |x_i + y_i|, scaled up for the terms that are NaN
+        return elementwiseDistance(A, B);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        uword notNanCount = 0;
+        for (uword i = 0; i < len; ++i) {
+            T ratio = std::abs(a[i] - b[i]) / std::abs(a[i] + b[i]);
+            bool isNumber = !std::isnan(ratio);
+            sum += isNumber ? ratio : 0;
+            notNanCount += isNumber;
         }
-
-        if (ratio.size() - notNanCount > 0) {
-            return ((notNanCount + 1) / static_cast<double>(notNanCount)) *
-                   arma::accu(ratio);
+        if (len - notNanCount > 0) {
+            return ((notNanCount + 1) / static_cast<T>(notNanCount)) * sum;
         } else {
-            return arma::accu(ratio);
+            return sum;
         }
     }
 };
@@ -77,83 +96,195 @@ class DistanceCanberra : public IDistance {
 //=======================
 // Chord
 //=======================
-class DistanceChord : public IDistance {
+class DistanceChord : public DistanceGramKernel<DistanceChord> {
   public:
+    explicit DistanceChord(bool gramEngine = false) : DistanceGramKernel<DistanceChord>(gramEngine) {}
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // sqrt(2 * (1 - xy / sqrt(xx * yy)))
         return std::sqrt(2 * (1 - arma::dot(A.row(0), B.row(0)) /
                                       std::sqrt(arma::dot(A.row(0), A.row(0)) *
                                                 arma::dot(B.row(0), B.row(0)))));
     }
+    bool preparesObservations() {
+        return true;
+    }
+    // x_i / sqrt(sum_i x_i^2)
+    void prepare(double *x, uword len) {
+        normaliseNorm(x, len);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        // rounding of the normalised observations may lift xy of equal observations above one
+        return std::sqrt(2 * (1 - std::min(dot(a, b, len), static_cast<T>(1))));
+    }
+    bool gramDistance(double xy, double xx, double yy, uword, double tolerance, double &dist) {
+        double cosine = xy / std::sqrt(xx * yy);
+        if (!(1 - std::abs(cosine) > tolerance)) {
+            return false;
+        }
+        dist = std::sqrt(2 * (1 - cosine));
+        return true;
+    }
 };
 
 //=======================
 // Divergence
 //=======================
-class DistanceDivergence : public IDistance {
+class DistanceDivergence : public DistanceRowKernel<DistanceDivergence> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // sum_i (x_i - y_i)^2 / (x_i + y_i)^2
-        arma::mat tmp = arma::square(A - B) / arma::square(A + B);
-        if (tmp.has_nan()) {
-            tmp.transform([](double val) { return (std::isnan(val) ? 0 : val); });
+        return elementwiseDistance(A, B);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            T diff = a[i] - b[i];
+            T total = a[i] + b[i];
+            T val = (diff * diff) / (total * total);
+            sum += std::isnan(val) ? 0 : val;
         }
-        return arma::accu(tmp);
+        return sum;
     }
 };
 
 //=======================
 // Euclidean distance
 //=======================
-class DistanceEuclidean : public IDistance {
+class DistanceEuclidean : public DistanceGramKernel<DistanceEuclidean> {
   public:
+    explicit DistanceEuclidean(bool gramEngine = false) : DistanceGramKernel<DistanceEuclidean>(gramEngine) {}
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         return std::sqrt(arma::accu(arma::square(A - B)));
     }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            T diff = a[i] - b[i];
+            sum += diff * diff;
+        }
+        return std::sqrt(sum);
+    }
+    double boundedKernel(const double *a, const double *b, uword len, double bound) {
+        double squaredBound = bound * bound;
+        double sum = 0;
+        for (uword i = 0; i < len;) {
+            for (uword chunkEnd = std::min(len, i + abandonChunk); i < chunkEnd; ++i) {
+                double diff = a[i] - b[i];
+                sum += diff * diff;
+            }
+            if (sum > squaredBound) {
+                break;
+            }
+        }
+        return std::sqrt(sum);
+    }
+    bool gramDistance(double xy, double xx, double yy, uword, double tolerance, double &dist) {
+        // xx + yy - 2xy cancels for close observations
+        double squared = xx + yy - 2 * xy;
+        if (!(squared > tolerance * (xx + yy))) {
+            return false;
+        }
+        dist = std::sqrt(squared);
+        return true;
+    }
 };
 
 //=======================
 // FJaccard
 //=======================
-class DistanceFJaccard : public IDistance {
+class DistanceFJaccard : public DistanceRowKernel<DistanceFJaccard> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
-        // sum_i (min{x_i, y_i} / max{x_i, y_i})
-        arma::mat tmp = arma::join_cols(A, B);
-        return util::similarityToDistance(arma::accu(colwise_min_idx(tmp)) /
-                                          arma::accu(colwise_max_idx(tmp)));
+        // sum_i min{x_i, y_i} / sum_i max{x_i, y_i}, minimum and maximum are taken over a column of both matrices
+        if (A.n_cols != B.n_cols) {
+            throw std::invalid_argument("Matrices of different size cannot be compared by this distance method.");
+        }
+        double minSum = 0, maxSum = 0;
+        for (uword j = 0; j < A.n_cols; ++j) {
+            double smallest, largest;
+            columnExtremes(A, B, j, smallest, largest);
+            minSum += smallest;
+            maxSum += largest;
+        }
+        return util::similarityToDistance(minSum / maxSum);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T minSum = 0, maxSum = 0;
+        for (uword i = 0; i < len; ++i) {
+            minSum += std::min(a[i], b[i]);
+            maxSum += std::max(a[i], b[i]);
+        }
+        return util::similarityToDistance(minSum / maxSum);
     }
 };
 
 //=======================
 // Geodesic
 //=======================
-class DistanceGeodesic : public IDistance {
+class DistanceGeodesic : public DistanceGramKernel<DistanceGeodesic> {
   public:
+    explicit DistanceGeodesic(bool gramEngine = false) : DistanceGramKernel<DistanceGeodesic>(gramEngine) {}
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // arccos(xy / sqrt(xx * yy))
         return acos(arma::dot(A.row(0), B.row(0)) /
                     std::sqrt(arma::dot(A.row(0), A.row(0)) *
                               arma::dot(B.row(0), B.row(0))));
     }
+    bool preparesObservations() {
+        return true;
+    }
+    // x_i / sqrt(sum_i x_i^2)
+    void prepare(double *x, uword len) {
+        normaliseNorm(x, len);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        // rounding of the normalised observations may lift |xy| above one
+        return acos(std::max(std::min(dot(a, b, len), static_cast<T>(1)), static_cast<T>(-1)));
+    }
+    bool gramDistance(double xy, double xx, double yy, uword, double tolerance, double &dist) {
+        double cosine = xy / std::sqrt(xx * yy);
+        if (!(1 - std::abs(cosine) > tolerance)) {
+            return false;
+        }
+        dist = acos(cosine);
+        return true;
+    }
 };
 
 //=======================
 // Hellinger
 //=======================
-class DistanceHellinger : public IDistance {
+class DistanceHellinger : public DistanceRowKernel<DistanceHellinger> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // sqrt(sum_i (sqrt(x_i / sum_i x) - sqrt(y_i / sum_i y)) ^ 2)
         return std::sqrt(arma::accu(arma::square(arma::sqrt(A / arma::accu(A)) -
                                                  arma::sqrt(B / arma::accu(B)))));
     }
+    bool preparesObservations() {
+        return true;
+    }
+    // sqrt(x_i / sum_i x)
+    void prepare(double *x, uword len) {
+        normaliseSum(x, len);
+        for (uword i = 0; i < len; ++i) {
+            x[i] = std::sqrt(x[i]);
+        }
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            T diff = a[i] - b[i];
+            sum += diff * diff;
+        }
+        return std::sqrt(sum);
+    }
 };
 
 //=======================
 // Kullback, Leibler
 //=======================
-class DistanceKullback : public IDistance {
+class DistanceKullback : public DistanceRowKernel<DistanceKullback> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // sum_i [x_i * log((x_i / sum_j x_j) / (y_i / sum_j y_j)) / sum_j x_j)]
@@ -164,113 +295,416 @@ class DistanceKullback : public IDistance {
         return std::isinf(result) ? std::numeric_limits<double>::quiet_NaN()
                                   : result;
     }
+    bool preparesObservations() {
+        return true;
+    }
+    // x_i / sum_i x
+    void prepare(double *x, uword len) {
+        normaliseSum(x, len);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T result = 0;
+        for (uword i = 0; i < len; ++i) {
+            result += a[i] * std::log(a[i] / b[i]);
+        }
+        // return same results as dist
+        return std::isinf(result) ? std::numeric_limits<T>::quiet_NaN()
+                                  : result;
+    }
 };
 
 //=======================
 // Mahalanobis
 //=======================
-class DistanceMahalanobis : public IDistance {
+class DistanceMahalanobis : public DistanceGramKernel<DistanceMahalanobis> {
   private:
     arma::mat invertedCov;
+    // upper triangular U with U'U = invertedCov, empty if invertedCov is not positive definite
+    arma::mat whitening;
+    // distances of whitened observations
+    DistanceEuclidean euclidean;
 
   public:
-    explicit DistanceMahalanobis(const arma::mat &invertedCov) {
-        this->invertedCov = invertedCov;
-    }
+    DistanceMahalanobis(const arma::mat &invertedCov, const arma::mat &whitening, bool gramEngine = false)
+        : DistanceGramKernel<DistanceMahalanobis>(gramEngine && !whitening.is_empty()), invertedCov(invertedCov),
+          whitening(whitening) {}
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         arma::mat C = A - B;
         return std::sqrt(arma::accu(C * this->invertedCov % C));
     }
+    bool preparesObservations() {
+        return !whitening.is_empty();
+    }
+    // U x for a block of observations with a single matrix product
+    void prepareObservations(double *observations, uword count, uword len) {
+        if (whitening.is_empty()) {
+            return;
+        }
+        arma::mat block(observations, len, count, false, true);
+        block = whitening * block;
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        if (!whitening.is_empty()) {
+            return euclidean.kernel(a, b, len);
+        }
+        // (a - b) * invertedCov * (a - b)', one column of invertedCov at a time, accumulated in double
+        // precision like the covariance matrix
+        double sum = 0;
+        for (uword j = 0; j < len; ++j) {
+            const double *covCol = this->invertedCov.colptr(j);
+            double colSum = 0;
+            for (uword i = 0; i < len; ++i) {
+                colSum += (a[i] - b[i]) * covCol[i];
+            }
+            sum += colSum * (a[j] - b[j]);
+        }
+        return static_cast<T>(std::sqrt(sum));
+    }
+    double boundedKernel(const double *a, const double *b, uword len, double bound) {
+        if (!whitening.is_empty()) {
+            return euclidean.boundedKernel(a, b, len, bound);
+        }
+        return kernel(a, b, len);
+    }
+    // only used for whitened observations
+    bool gramDistance(double xy, double xx, double yy, uword len, double tolerance, double &dist) {
+        return euclidean.gramDistance(xy, xx, yy, len, tolerance, dist);
+    }
 };
 
 //=======================
 // Manhattan distance
 //=======================
-class DistanceManhattan : public IDistance {
+class DistanceManhattan : public DistanceRowKernel<DistanceManhattan> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         return arma::accu(arma::abs(A - B));
     }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            sum += std::abs(a[i] - b[i]);
+        }
+        return sum;
+    }
+    double boundedKernel(const double *a, const double *b, uword len, double bound) {
+        double sum = 0;
+        for (uword i = 0; i < len;) {
+            for (uword chunkEnd = std::min(len, i + abandonChunk); i < chunkEnd; ++i) {
+                sum += std::abs(a[i] - b[i]);
+            }
+            if (sum > bound) {
+                break;
+            }
+        }
+        return sum;
+    }
 };
 
 //=======================
 // Maximum distance
 //=======================
-class DistanceMaximum : public IDistance {
+class DistanceMaximum : public DistanceRowKernel<DistanceMaximum> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         return arma::abs(A - B).max();
     }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T max = 0;
+        for (uword i = 0; i < len; ++i) {
+            T diff = std::abs(a[i] - b[i]);
+            if (diff > max || std::isnan(diff)) {
+                max = diff;
+            }
+        }
+        return max;
+    }
+    double boundedKernel(const double *a, const double *b, uword len, double bound) {
+        double max = 0;
+        for (uword i = 0; i < len; ++i) {
+            double diff = std::abs(a[i] - b[i]);
+            if (diff > max || std::isnan(diff)) {
+                max = diff;
+                if (max > bound) {
+                    break;
+                }
+            }
+        }
+        return max;
+    }
 };
 
 //=======================
 // Minkowski distance
 //=======================
-class DistanceMinkowski : public IDistance {
+// Exponents of the minkowski kernels: 1 to 4 are fixed at compile time, any other integer exponent is applied by
+// repeated multiplication and only real exponents call std::pow.
+enum MinkowskiExponent { IntegerExponent = 0,
+                         RealExponent = -1 };
+
+template <int Exponent>
+class DistanceMinkowski : public DistanceRowKernel<DistanceMinkowski<Exponent>> {
   private:
     double p;
+    unsigned int integerP;
+
+    // |x|^p
+    template <typename T> inline T power(T x) {
+        x = std::abs(x);
+        switch (Exponent) {
+        case 1:
+            return x;
+        case 2:
+            return x * x;
+        case 3:
+            return x * x * x;
+        case 4: {
+            T square = x * x;
+            return square * square;
+        }
+        case IntegerExponent: {
+            T result = 1;
+            for (unsigned int n = integerP; n > 0; n >>= 1, x *= x) {
+                if (n & 1) {
+                    result *= x;
+                }
+            }
+            return result;
+        }
+        default:
+            return std::pow(x, p);
+        }
+    }
+
+    // sum^(1 / p)
+    template <typename T> inline T root(T sum) {
+        switch (Exponent) {
+        case 1:
+            return sum;
+        case 2:
+            return std::sqrt(sum);
+        case 3:
+            return std::cbrt(sum);
+        case 4:
+            return std::sqrt(std::sqrt(sum));
+        default:
+            return std::pow(sum, 1.0 / p);
+        }
+    }
 
   public:
-    explicit DistanceMinkowski(double p) { this->p = p; }
+    explicit DistanceMinkowski(double p) : p(p), integerP(Exponent == IntegerExponent ? p : 0) {}
     ~DistanceMinkowski() {}
     double calcDistance(const arma::mat &A, const arma::mat &B) {
-        return std::pow(arma::accu(arma::pow(arma::abs(A - B), this->p)),
-                        1.0 / this->p);
+        return this->elementwiseDistance(A, B);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            sum += power(a[i] - b[i]);
+        }
+        return root(sum);
+    }
+    double boundedKernel(const double *a, const double *b, uword len, double bound) {
+        double powerBound = power(bound);
+        double sum = 0;
+        for (uword i = 0; i < len;) {
+            for (uword chunkEnd = std::min(len, i + this->abandonChunk); i < chunkEnd; ++i) {
+                sum += power(a[i] - b[i]);
+            }
+            if (sum > powerBound) {
+                break;
+            }
+        }
+        return root(sum);
     }
 };
 
 //=======================
 // Podani
 //=======================
-class DistancePodani : public IDistance {
-  public:
-    double calcDistance(const arma::mat &A, const arma::mat &B) {
-        uint64_t n = A.n_cols;
-        uint64_t a, b, c, d;
-        a = b = c = d = 0;
-        for (unsigned int i = 0; i < n; i++) {
-            for (unsigned int j = i + 1; j < n; j++) {
-                if ((A(0, i) < A(0, j) && B(0, i) < B(0, j)) ||
-                    (A(0, i) > A(0, j) && B(0, i) > B(0, j))) {
+// The counts of a pair of observations are taken from a single sort instead of comparing all pairs of variables:
+// after sorting the variables by x and then by y, the reversely ordered pairs are the inversions of y, and the tied
+// pairs are the pairs within the runs of equal x, equal y and equal (x, y).
+class DistancePodani : public DistanceRowKernel<DistancePodani> {
+  private:
+    // below this number of variables, or with NaNs, the pairs of variables are compared directly
+    static const uword directCount = 32;
+
+    static uint64_t pairCount(uint64_t k) {
+        return k * (k - 1) / 2;
+    }
+
+    template <typename T>
+    static void directCounts(const T *x, const T *y, uword n, uint64_t &a, uint64_t &b, uint64_t &c, uint64_t &d) {
+        for (uword i = 0; i < n; i++) {
+            for (uword j = i + 1; j < n; j++) {
+                if ((x[i] < x[j] && y[i] < y[j]) || (x[i] > x[j] && y[i] > y[j])) {
                     a++;
                 }
-                if ((A(0, i) < A(0, j) && B(0, i) > B(0, j)) ||
-                    (A(0, i) > A(0, j) && B(0, i) < B(0, j))) {
+                if ((x[i] < x[j] && y[i] > y[j]) || (x[i] > x[j] && y[i] < y[j])) {
                     b++;
                 }
-                if (A(0, i) == A(0, j) && B(0, i) == B(0, j) &&
-                    ((A(0, i) == 0 && B(0, i) == 0) || (A(0, i) > 0 && B(0, i) > 0))) {
+                if (x[i] == x[j] && y[i] == y[j] && ((x[i] == 0 && y[i] == 0) || (x[i] > 0 && y[i] > 0))) {
                     c++;
                 }
 
-                unsigned int z = 0;
-                if (A(0, i) == 0)
-                    ++z;
-                if (A(0, j) == 0)
-                    ++z;
-                if (B(0, i) == 0)
-                    ++z;
-                if (B(0, j) == 0)
-                    ++z;
-
-                if ((A(0, i) == A(0, j) || B(0, i) == B(0, j)) && z > 0 && z < 4) {
+                unsigned int z = (x[i] == 0) + (x[j] == 0) + (y[i] == 0) + (y[j] == 0);
+                if ((x[i] == x[j] || y[i] == y[j]) && z > 0 && z < 4) {
                     d++;
                 }
             }
         }
-        return 1 - 2 * (static_cast<double>(a) - b + c - d) / (n * (n - 1));
+    }
+
+    // number of pairs p < q with y[order[p]] > y[order[q]], order is sorted by y on return
+    template <typename T>
+    static uint64_t sortInversions(const T *y, std::vector<uword> &order, std::vector<uword> &buffer) {
+        uint64_t inversions = 0;
+        uword n = order.size();
+        for (uword width = 1; width < n; width *= 2) {
+            for (uword lo = 0; lo < n; lo += 2 * width) {
+                uword mid = std::min(lo + width, n), hi = std::min(lo + 2 * width, n);
+                uword l = lo, r = mid, k = lo;
+                while (l < mid && r < hi) {
+                    if (y[order[r]] < y[order[l]]) {
+                        inversions += mid - l;
+                        buffer[k++] = order[r++];
+                    } else {
+                        buffer[k++] = order[l++];
+                    }
+                }
+                while (l < mid) {
+                    buffer[k++] = order[l++];
+                }
+                while (r < hi) {
+                    buffer[k++] = order[r++];
+                }
+            }
+            order.swap(buffer);
+        }
+        return inversions;
+    }
+
+    // pairs of variables tied in the values of the sorted order, in total and with both observations nonzero
+    template <typename T>
+    static void tiedCounts(const T *values, const T *other, const std::vector<uword> &order, uint64_t &tied,
+                           uint64_t &tiedNonzero) {
+        uword n = order.size();
+        for (uword start = 0, end; start < n; start = end) {
+            uint64_t nonzero = 0;
+            for (end = start; end < n && values[order[end]] == values[order[start]]; ++end) {
+                nonzero += values[order[end]] != 0 && other[order[end]] != 0;
+            }
+            tied += pairCount(end - start);
+            tiedNonzero += pairCount(nonzero);
+        }
+    }
+
+    // orders variables by x and then by y
+    template <typename T> struct JointOrder {
+        const T *x, *y;
+        JointOrder(const T *x, const T *y) : x(x), y(y) {}
+        bool operator()(uword i, uword j) const {
+            return x[i] < x[j] || (x[i] == x[j] && y[i] < y[j]);
+        }
+    };
+
+    template <typename T>
+    static void sortedCounts(const T *x, const T *y, uword n, uint64_t &a, uint64_t &b, uint64_t &c, uint64_t &d) {
+        std::vector<uword> order(n), buffer(n);
+        for (uword i = 0; i < n; ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), JointOrder<T>(x, y));
+
+        // ties in x, in both and pairs of variables with all four scores zero
+        uint64_t tiedX = 0, tiedXNonzero = 0, tiedBoth = 0, tiedBothNonzero = 0, zeros = 0;
+        tiedCounts(x, y, order, tiedX, tiedXNonzero);
+        for (uword start = 0, end; start < n; start = end) {
+            T xs = x[order[start]], ys = y[order[start]];
+            for (end = start; end < n && x[order[end]] == xs && y[order[end]] == ys; ++end) {
+            }
+            uint64_t pairs = pairCount(end - start);
+            tiedBoth += pairs;
+            if (xs != 0 && ys != 0) {
+                tiedBothNonzero += pairs;
+            }
+            if ((xs == 0 && ys == 0) || (xs > 0 && ys > 0)) {
+                c += pairs;
+            }
+            if (xs == 0 && ys == 0) {
+                zeros += pairs;
+            }
+        }
+
+        // pairs with x ascending and y descending, variables tied in x are already ordered by y
+        b = sortInversions(y, order, buffer);
+        uint64_t tiedY = 0, tiedYNonzero = 0;
+        tiedCounts(y, x, order, tiedY, tiedYNonzero);
+
+        a = pairCount(n) - tiedX - tiedY + tiedBoth - b;
+        // pairs tied in x or y, except those with no zero or only zeros
+        d = (tiedX + tiedY - tiedBoth) - (tiedXNonzero + tiedYNonzero - tiedBothNonzero) - zeros;
+    }
+
+    template <typename T> static bool hasNaN(const T *x, uword n) {
+        for (uword i = 0; i < n; ++i) {
+            if (x[i] != x[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+  public:
+    double calcDistance(const arma::mat &A, const arma::mat &B) {
+        // only the first rows of list matrices are compared
+        if (A.n_cols != B.n_cols) {
+            throw std::invalid_argument("Matrices of different size cannot be compared by this distance method.");
+        }
+        const arma::rowvec x = A.row(0), y = B.row(0);
+        return kernel(x.memptr(), y.memptr(), A.n_cols);
+    }
+    template <typename T> T kernel(const T *x, const T *y, uword n) {
+        uint64_t a, b, c, d;
+        a = b = c = d = 0;
+        if (n < directCount || hasNaN(x, n) || hasNaN(y, n)) {
+            directCounts(x, y, n, a, b, c, d);
+        } else {
+            sortedCounts(x, y, n, a, b, c, d);
+        }
+        return static_cast<T>(1 - 2 * (static_cast<double>(a) - b + c - d) / (n * (n - 1)));
     }
 };
 
 //=======================
 // Soergel
 //=======================
-class DistanceSoergel : public IDistance {
+class DistanceSoergel : public DistanceRowKernel<DistanceSoergel> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
-        // sum_i |x_i - y_i| / sum_i max{x_i, y_i}
-        arma::mat tmp = arma::join_cols(A, B);
-        return arma::accu(arma::abs(A - B)) / arma::accu(colwise_max_idx(tmp));
+        // sum_i |x_i - y_i| / sum_i max{x_i, y_i}, the maximum is taken over a column of both matrices
+        checkSameSize(A, B);
+        double numerator = 0, denominator = 0;
+        for (uword j = 0; j < A.n_cols; ++j) {
+            const double *a = A.colptr(j), *b = B.colptr(j);
+            for (uword i = 0; i < A.n_rows; ++i) {
+                numerator += std::abs(a[i] - b[i]);
+            }
+            double smallest, largest;
+            columnExtremes(A, B, j, smallest, largest);
+            denominator += largest;
+        }
+        return numerator / denominator;
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T numerator = 0, denominator = 0;
+        for (uword i = 0; i < len; ++i) {
+            numerator += std::abs(a[i] - b[i]);
+            denominator += std::max(a[i], b[i]);
+        }
+        return numerator / denominator;
     }
 };
 
@@ -280,48 +714,103 @@ class DistanceSoergel : public IDistance {
 // between Probability Density Functions
 // Sung-Hyuk Cha
 //=======================
-class DistanceWave : public IDistance {
+class DistanceWave : public DistanceRowKernel<DistanceWave> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
-        // sum_i (1 - min(x_i, y_i) / max(x_i, y_i))
-        arma::mat tmp = arma::join_cols(A, B);
-        arma::mat substr = arma::abs(A - B);
-        return arma::accu(substr / repmat(colwise_max_idx(tmp), substr.n_rows, 1));
+        // sum_i (1 - min(x_i, y_i) / max(x_i, y_i)), the maximum is taken over a column of both matrices
+        checkSameSize(A, B);
+        double sum = 0;
+        for (uword j = 0; j < A.n_cols; ++j) {
+            const double *a = A.colptr(j), *b = B.colptr(j);
+            double smallest, largest;
+            columnExtremes(A, B, j, smallest, largest);
+            for (uword i = 0; i < A.n_rows; ++i) {
+                sum += std::abs(a[i] - b[i]) / largest;
+            }
+        }
+        return sum;
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            sum += std::abs(a[i] - b[i]) / std::max(a[i], b[i]);
+        }
+        return sum;
     }
 };
 
 //=======================
 // Whittaker
 //=======================
-class DistanceWhittaker : public IDistance {
+class DistanceWhittaker : public DistanceRowKernel<DistanceWhittaker> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         // sum_i |x_i / sum_i x - y_i / sum_i y| / 2
         return arma::accu(arma::abs(A / arma::accu(A) - B / arma::accu(B))) / 2.0;
     }
+    bool preparesObservations() {
+        return true;
+    }
+    // x_i / sum_i x
+    void prepare(double *x, uword len) {
+        normaliseSum(x, len);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        T sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            sum += std::abs(a[i] - b[i]);
+        }
+        return sum / 2.0;
+    }
 };
 
 //=======================
 // Cosine
 //=======================
-class DistanceCosine : public IDistance {
+class DistanceCosine : public DistanceGramKernel<DistanceCosine> {
   public:
+    explicit DistanceCosine(bool gramEngine = false) : DistanceGramKernel<DistanceCosine>(gramEngine) {}
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         return 1.0 - (
             arma::as_scalar(arma::dot(A, B)) /
             (arma::as_scalar(arma::norm(A)) * arma::as_scalar(arma::norm(B))));
     }
+    bool preparesObservations() {
+        return true;
+    }
+    // x_i / sqrt(sum_i x_i^2)
+    void prepare(double *x, uword len) {
+        normaliseNorm(x, len);
+    }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        return 1.0 - dot(a, b, len);
+    }
+    bool gramDistance(double xy, double xx, double yy, uword, double tolerance, double &dist) {
+        double cosine = xy / (std::sqrt(xx) * std::sqrt(yy));
+        if (!(1 - std::abs(cosine) > tolerance)) {
+            return false;
+        }
+        dist = 1.0 - cosine;
+        return true;
+    }
 };
 
 //=======================
 // Hamming distance
 //=======================
-class DistanceHamming : public IDistance {
+class DistanceHamming : public DistanceRowKernel<DistanceHamming> {
   public:
     double calcDistance(const arma::mat &A, const arma::mat &B) {
         double nc = A.n_cols;
         return arma::accu(A != B) / nc;
     }
+    template <typename T> T kernel(const T *a, const T *b, uword len) {
+        uword mismatches = 0;
+        for (uword i = 0; i < len; ++i) {
+            mismatches += a[i] != b[i];
+        }
+        return mismatches / static_cast<T>(len);
+    }
 };
 
 //=======================
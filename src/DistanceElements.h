@@ -0,0 +1,116 @@
+// DistanceElements.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISTANCEELEMENTS_H_
+#define DISTANCEELEMENTS_H_
+
+#include "CoreBackend.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+using arma::uword;
+
+//==============================
+// Integer and byte observations
+//==============================
+// Matrices of 32-bit integers (integer and logical matrices of R) and of bytes (raw matrices of R) are read in
+// their own width instead of a copy in double precision. The hamming distance compares their elements directly and
+// the binary measures pack them into bits, the other methods take the values widened to double precision. The
+// smallest 32-bit integer marks a missing value like NA of R, it is widened to NaN and differs from every value.
+namespace elements {
+
+const int32_t missingInteger = std::numeric_limits<int32_t>::min();
+
+inline double widen(int32_t x) {
+    return x == missingInteger ? std::numeric_limits<double>::quiet_NaN() : x;
+}
+
+inline double widen(uint8_t x) {
+    return x;
+}
+
+inline bool isMissing(int32_t x) {
+    return x == missingInteger;
+}
+
+inline bool isMissing(uint8_t) {
+    return false;
+}
+
+// number of positions at which two observations differ, if at least one of them has no missing values
+inline uword mismatches(const int32_t *a, const int32_t *b, uword len) {
+    uword count = 0;
+    for (uword i = 0; i < len; ++i) {
+        count += a[i] != b[i];
+    }
+    return count;
+}
+
+// The bytes are compared eight at a time: the low bit of each byte of a mask is set where the bytes differ, and
+// the masks are summed bytewise over at most 255 words before the bytes of the sum are added up.
+inline uword mismatches(const uint8_t *a, const uint8_t *b, uword len) {
+    const uint64_t lowBits = 0x7F7F7F7F7F7F7F7FULL;
+    const uint64_t evenBytes = 0x00FF00FF00FF00FFULL;
+    uword count = 0;
+    uword i = 0;
+    while (i + 8 <= len) {
+        uword end = std::min<uword>(len - (len - i) % 8, i + 8 * 255);
+        uint64_t sums = 0;
+        for (; i < end; i += 8) {
+            uint64_t u, v;
+            std::memcpy(&u, a + i, sizeof(u));
+            std::memcpy(&v, b + i, sizeof(v));
+            uint64_t x = u ^ v;
+            sums += ((((x & lowBits) + lowBits) | x) & ~lowBits) >> 7;
+        }
+        sums = (sums & evenBytes) + ((sums >> 8) & evenBytes);
+        count += (sums * 0x0001000100010001ULL) >> 48;
+    }
+    for (; i < len; ++i) {
+        count += a[i] != b[i];
+    }
+    return count;
+}
+
+// number of positions at which two observations differ, missing values differ from every value like NaN
+template <typename E> uword mismatchesWithMissing(const E *a, const E *b, uword len) {
+    uword count = 0;
+    for (uword i = 0; i < len; ++i) {
+        count += (a[i] != b[i]) | isMissing(a[i]);
+    }
+    return count;
+}
+
+/**
+ Hamming distance of two observations, the share of differing positions like DistanceHamming
+ @param a first observation
+ @param b second observation
+ @param len number of elements of an observation
+ @param complete whether a or b has no missing values
+ @return distance between a and b
+ */
+template <typename E> double hamming(const E *a, const E *b, uword len, bool complete) {
+    return (complete ? mismatches(a, b, len) : mismatchesWithMissing(a, b, len)) / static_cast<double>(len);
+}
+
+} // namespace elements
+
+#endif // DISTANCEELEMENTS_H_
@@ -23,12 +23,88 @@
 #include "DistanceDist.h"
 #include "Util.h"
 
-std::shared_ptr<IDistance> DistanceFactory::createDistanceFunction(const Rcpp::List &attrs,
-                                                                   const Rcpp::List &arguments) {
+#include <cmath>
+#include <stdexcept>
+
+// minkowski distance specialised for its exponent
+std::shared_ptr<IDistance> createMinkowski(double p) {
+    if (p == 1) {
+        return std::make_shared<DistanceMinkowski<1>>(p);
+    } else if (p == 2) {
+        return std::make_shared<DistanceMinkowski<2>>(p);
+    } else if (p == 3) {
+        return std::make_shared<DistanceMinkowski<3>>(p);
+    } else if (p == 4) {
+        return std::make_shared<DistanceMinkowski<4>>(p);
+    } else if (p > 0 && p <= 1024 && p == std::floor(p)) {
+        return std::make_shared<DistanceMinkowski<IntegerExponent>>(p);
+    }
+    return std::make_shared<DistanceMinkowski<RealExponent>>(p);
+}
+
+// binary distance measure of the given name, NULL for other methods
+std::shared_ptr<IDistance> createBinaryMeasure(const std::string &name, bool gramEngine) {
+    using util::isEqualStr;
+    if (isEqualStr(name, "binary")) {
+        return std::make_shared<DistanceBinary>(gramEngine);
+    } else if (isEqualStr(name, "braun-blanquet")) {
+        return std::make_shared<DistanceBraunblanquet>(gramEngine);
+    } else if (isEqualStr(name, "dice")) {
+        return std::make_shared<DistanceDice>(gramEngine);
+    } else if (isEqualStr(name, "fager")) {
+        return std::make_shared<DistanceFager>(gramEngine);
+    } else if (isEqualStr(name, "faith")) {
+        return std::make_shared<DistanceFaith>(gramEngine);
+    } else if (isEqualStr(name, "hamman")) {
+        return std::make_shared<DistanceHamman>(gramEngine);
+    } else if (isEqualStr(name, "kulczynski1")) {
+        return std::make_shared<DistanceKulczynski1>(gramEngine);
+    } else if (isEqualStr(name, "kulczynski2")) {
+        return std::make_shared<DistanceKulczynski2>(gramEngine);
+    } else if (isEqualStr(name, "michael")) {
+        return std::make_shared<DistanceMichael>(gramEngine);
+    } else if (isEqualStr(name, "mountford")) {
+        return std::make_shared<DistanceMountford>(gramEngine);
+    } else if (isEqualStr(name, "mozley")) {
+        return std::make_shared<DistanceMozley>(gramEngine);
+    } else if (isEqualStr(name, "ochiai")) {
+        return std::make_shared<DistanceOchiai>(gramEngine);
+    } else if (isEqualStr(name, "phi")) {
+        return std::make_shared<DistancePhi>(gramEngine);
+    } else if (isEqualStr(name, "russel")) {
+        return std::make_shared<DistanceRussel>(gramEngine);
+    } else if (isEqualStr(name, "simple matching")) {
+        return std::make_shared<DistanceSimplematching>(gramEngine);
+    } else if (isEqualStr(name, "simpson")) {
+        return std::make_shared<DistanceSimpson>(gramEngine);
+    } else if (isEqualStr(name, "stiles")) {
+        return std::make_shared<DistanceStiles>(gramEngine);
+    } else if (isEqualStr(name, "tanimoto")) {
+        return std::make_shared<DistanceTanimoto>(gramEngine);
+    } else if (isEqualStr(name, "yule")) {
+        return std::make_shared<DistanceYule>(gramEngine);
+    } else if (isEqualStr(name, "yule2")) {
+        return std::make_shared<DistanceYule2>(gramEngine);
+    }
+    return NULL;
+}
+
+std::shared_ptr<IDistance> DistanceFactory::createDistanceFunction(const DistanceOptions &options) {
     using util::isEqualStr;
-    std::string distName = attrs["method"];
+    const std::string &distName = options.method;
     std::shared_ptr<IDistance> distanceFunction = NULL;
 
+    // block engine for inner product based distances
+    bool gramEngine = isEqualStr(options.engine, "gemm");
+    if (!gramEngine && !isEqualStr(options.engine, "pairwise")) {
+        throw std::invalid_argument("Engine must be either 'pairwise' or 'gemm'.");
+    }
+
+    std::shared_ptr<IDistance> binaryMeasure = createBinaryMeasure(distName, gramEngine);
+    if (binaryMeasure != NULL) {
+        return binaryMeasure;
+    }
+
     if (isEqualStr(distName, "bhjattacharyya")) {
         distanceFunction = std::make_shared<DistanceBhjattacharyya>();
     } else if (isEqualStr(distName, "bray")) {
@@ -36,53 +112,53 @@ std::shared_ptr<IDistance> DistanceFactory::createDistanceFunction(const Rcpp::L
     } else if (isEqualStr(distName, "canberra")) {
         distanceFunction = std::make_shared<DistanceCanberra>();
     } else if (isEqualStr(distName, "chord")) {
-        distanceFunction = std::make_shared<DistanceChord>();
+        distanceFunction = std::make_shared<DistanceChord>(gramEngine);
     } else if (isEqualStr(distName, "divergence")) {
         distanceFunction = std::make_shared<DistanceDivergence>();
     } else if (isEqualStr(distName, "dtw")) {
-        distanceFunction = DistanceDTWFactory().createDistanceFunction(distName, arguments);
+        distanceFunction = DistanceDTWFactory().createDistanceFunction(options);
     } else if (isEqualStr(distName, "fJaccard")) {
         distanceFunction = std::make_shared<DistanceFJaccard>();
     } else if (isEqualStr(distName, "geodesic")) {
-        distanceFunction = std::make_shared<DistanceGeodesic>();
+        distanceFunction = std::make_shared<DistanceGeodesic>(gramEngine);
     } else if (isEqualStr(distName, "hellinger")) {
         distanceFunction = std::make_shared<DistanceHellinger>();
     } else if (isEqualStr(distName, "kullback")) {
         distanceFunction = std::make_shared<DistanceKullback>();
     } else if (isEqualStr(distName, "cosine")) {
-        distanceFunction = std::make_shared<DistanceCosine>();
+        distanceFunction = std::make_shared<DistanceCosine>(gramEngine);
     } else if (isEqualStr(distName, "mahalanobis")) {
-        bool isInvertedCov = false;
-        bool isCov = arguments.containsElementNamed("cov");
-        arma::Mat<double> cov;
-        if (isCov) {
-            cov = Rcpp::as<arma::Mat<double>>(arguments["cov"]);
-        } else {
+        bool isInvertedCov = options.inverted;
+        arma::Mat<double> cov = options.cov;
+        if (cov.is_empty()) {
             // if data was provided as matrix
             if (this->isDataMatrix) {
                 // calc covariance matrix if input data is in matrix format
-                cov = arma::cov(dataMatrix);
+                cov = arma::cov(*dataMatrix);
             } else {
-                Rcpp::stop("Calculation of inverted covariance matrix is only supported for input data in matrix format.");
+                throw std::invalid_argument(
+                    "Calculation of inverted covariance matrix is only supported for input data in matrix format.");
             }
         }
-        if (arguments.containsElementNamed("inverted")) {
-            isInvertedCov = Rcpp::as<bool>(arguments["inverted"]);
+        if (this->isDataMatrix && (cov.n_rows != dataMatrix->n_cols || cov.n_cols != dataMatrix->n_cols)) {
+            throw std::invalid_argument("The covariance matrix must have as many rows and columns as x has columns.");
         }
         if (!isInvertedCov) {
             cov = arma::inv(cov);
         }
-        distanceFunction = std::make_shared<DistanceMahalanobis>(cov);
+        // factor the quadratic form once, x' M x = x' ((M + M') / 2) x = |U x|^2 with U upper triangular, so
+        // observations are whitened once and compared by euclidean distance. The factorisation is empty for
+        // matrices which are not positive definite, which keep the quadratic form.
+        arma::mat symmetric = (cov + cov.t()) / 2.0;
+        arma::mat whitening;
+        arma::chol(whitening, symmetric);
+        distanceFunction = std::make_shared<DistanceMahalanobis>(cov, whitening, gramEngine);
     } else if (isEqualStr(distName, "manhattan")) {
         distanceFunction = std::make_shared<DistanceManhattan>();
     } else if (isEqualStr(distName, "maximum")) {
         distanceFunction = std::make_shared<DistanceMaximum>();
     } else if (isEqualStr(distName, "minkowski")) {
-        double p = 2;
-        if (arguments.containsElementNamed("p")) {
-            p = Rcpp::as<double>(arguments["p"]);
-        }
-        distanceFunction = std::make_shared<DistanceMinkowski>(p);
+        distanceFunction = createMinkowski(options.p);
     } else if (isEqualStr(distName, "podani")) {
         distanceFunction = std::make_shared<DistancePodani>();
     } else if (isEqualStr(distName, "soergel")) {
@@ -91,54 +167,15 @@ std::shared_ptr<IDistance> DistanceFactory::createDistanceFunction(const Rcpp::L
         distanceFunction = std::make_shared<DistanceWave>();
     } else if (isEqualStr(distName, "whittaker")) {
         distanceFunction = std::make_shared<DistanceWhittaker>();
-    } else if (isEqualStr(distName, "binary")) {
-        distanceFunction = std::make_shared<DistanceBinary>();
-    } else if (isEqualStr(distName, "braun-blanquet")) {
-        distanceFunction = std::make_shared<DistanceBraunblanquet>();
-    } else if (isEqualStr(distName, "dice")) {
-        distanceFunction = std::make_shared<DistanceDice>();
-    } else if (isEqualStr(distName, "fager")) {
-        distanceFunction = std::make_shared<DistanceFager>();
-    } else if (isEqualStr(distName, "faith")) {
-        distanceFunction = std::make_shared<DistanceFaith>();
-    } else if (isEqualStr(distName, "hamman")) {
-        distanceFunction = std::make_shared<DistanceHamman>();
-    } else if (isEqualStr(distName, "kulczynski1")) {
-        distanceFunction = std::make_shared<DistanceKulczynski1>();
-    } else if (isEqualStr(distName, "kulczynski2")) {
-        distanceFunction = std::make_shared<DistanceKulczynski2>();
-    } else if (isEqualStr(distName, "michael")) {
-        distanceFunction = std::make_shared<DistanceMichael>();
-    } else if (isEqualStr(distName, "mountford")) {
-        distanceFunction = std::make_shared<DistanceMountford>();
-    } else if (isEqualStr(distName, "mozley")) {
-        distanceFunction = std::make_shared<DistanceMozley>();
-    } else if (isEqualStr(distName, "ochiai")) {
-        distanceFunction = std::make_shared<DistanceOchiai>();
-    } else if (isEqualStr(distName, "phi")) {
-        distanceFunction = std::make_shared<DistancePhi>();
-    } else if (isEqualStr(distName, "russel")) {
-        distanceFunction = std::make_shared<DistanceRussel>();
-    } else if (isEqualStr(distName, "simple matching")) {
-        distanceFunction = std::make_shared<DistanceSimplematching>();
-    } else if (isEqualStr(distName, "simpson")) {
-        distanceFunction = std::make_shared<DistanceSimpson>();
-    } else if (isEqualStr(distName, "stiles")) {
-        distanceFunction = std::make_shared<DistanceStiles>();
-    } else if (isEqualStr(distName, "tanimoto")) {
-        distanceFunction = std::make_shared<DistanceTanimoto>();
-    } else if (isEqualStr(distName, "yule")) {
-        distanceFunction = std::make_shared<DistanceYule>();
-    } else if (isEqualStr(distName, "yule2")) {
-        distanceFunction = std::make_shared<DistanceYule2>();
     } else if (isEqualStr(distName, "hamming")) {
         distanceFunction = std::make_shared<DistanceHamming>();
     } else if (isEqualStr(distName, "custom")) {
-        SEXP func_ = arguments["func"];
-        funcPtr func = *Rcpp::XPtr<funcPtr>(func_);
-        distanceFunction = std::make_shared<DistanceCustom>(func);
+        if (options.customFunction == NULL) {
+            throw std::invalid_argument("Parameter 'func' is missing.");
+        }
+        distanceFunction = std::make_shared<DistanceCustom>(options.customFunction);
     } else {
-        distanceFunction = std::make_shared<DistanceEuclidean>();
+        distanceFunction = std::make_shared<DistanceEuclidean>(gramEngine);
     }
     return distanceFunction;
 }
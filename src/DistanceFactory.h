@@ -20,25 +20,31 @@
 #ifndef DISTANCEFACTORY_H_
 #define DISTANCEFACTORY_H_
 
+#include "DistanceOptions.h"
 #include "IDistance.h"
 #include <memory>
+#include <string>
 #include <vector>
 
+// binary distance measure of the given name, NULL for other methods
+std::shared_ptr<IDistance> createBinaryMeasure(const std::string &name, bool gramEngine);
+
 //==============================
 // Distance Factory
 //==============================
 class DistanceFactory {
   private:
     // Store reference to data objects to enable distance method parameter precalculations
-    arma::mat dataMatrix;
-    std::vector<arma::mat> dataMatrixList;
+    const arma::mat *dataMatrix;
+    const std::vector<arma::mat> *dataMatrixList;
     bool isDataMatrix;
 
   public:
-    explicit DistanceFactory(arma::mat &dataMatrix) : dataMatrix(dataMatrix), isDataMatrix(true) {}
-    explicit DistanceFactory(std::vector<arma::mat> &dataMatrixList) : dataMatrixList(dataMatrixList),
-                                                                       isDataMatrix(false) {}
-    std::shared_ptr<IDistance> createDistanceFunction(const Rcpp::List &attrs, const Rcpp::List &arguments);
+    explicit DistanceFactory(const arma::mat &dataMatrix)
+        : dataMatrix(&dataMatrix), dataMatrixList(NULL), isDataMatrix(true) {}
+    explicit DistanceFactory(const std::vector<arma::mat> &dataMatrixList)
+        : dataMatrix(NULL), dataMatrixList(&dataMatrixList), isDataMatrix(false) {}
+    std::shared_ptr<IDistance> createDistanceFunction(const DistanceOptions &options);
 };
 
 #endif // DISTANCEFACTORY_H_
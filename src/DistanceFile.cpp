@@ -0,0 +1,253 @@
+// DistanceFile.cpp
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <RcppArmadillo.h>
+
+#include "DistanceFile.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char magic[8] = {'P', 'D', 'I', 'S', 'T', 'M', 'M', '\0'};
+const uint32_t version = 1;
+const uint64_t alignment = 64;
+// position of the progress fields, behind magic, version, element size, size and data offset
+const std::size_t progressPosition = sizeof(magic) + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+template <typename T> void append(std::vector<char> &buffer, const T &value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void appendString(std::vector<char> &buffer, const std::string &str) {
+    append<uint64_t>(buffer, str.size());
+    buffer.insert(buffer.end(), str.begin(), str.end());
+}
+
+// sequential reader of the header with bounds checks
+class HeaderReader {
+  private:
+    const char *position;
+    const char *end;
+
+  public:
+    HeaderReader(const void *begin, std::size_t length)
+        : position(static_cast<const char *>(begin)), end(static_cast<const char *>(begin) + length) {}
+
+    bool read(void *target, uint64_t count) {
+        if (count > static_cast<uint64_t>(end - position)) {
+            return false;
+        }
+        std::memcpy(target, position, count);
+        position += count;
+        return true;
+    }
+
+    bool readString(std::string &str) {
+        uint64_t size;
+        if (!read(&size, sizeof(size)) || size > static_cast<uint64_t>(end - position)) {
+            return false;
+        }
+        str.assign(position, size);
+        position += size;
+        return true;
+    }
+};
+
+} // namespace
+
+DistanceFile::DistanceFile(const std::string &path, const Header &header)
+    : path(path), header(header), dataOffset(0), length(0), address(NULL), writable(true) {
+    std::vector<char> buffer(magic, magic + sizeof(magic));
+    append<uint32_t>(buffer, version);
+    append<uint32_t>(buffer, header.elementSize);
+    append<uint64_t>(buffer, header.size);
+    // placeholder for the offset of the data section
+    std::size_t offsetPosition = buffer.size();
+    append<uint64_t>(buffer, 0);
+    append<uint64_t>(buffer, header.tileSize);
+    append<uint64_t>(buffer, header.workItems);
+    append<uint64_t>(buffer, header.completed);
+    appendString(buffer, header.method);
+    append<uint64_t>(buffer, header.labels.size());
+    for (std::size_t i = 0; i < header.labels.size(); i++) {
+        appendString(buffer, header.labels[i]);
+    }
+    dataOffset = (buffer.size() + alignment - 1) / alignment * alignment;
+    std::memcpy(&buffer[offsetPosition], &dataOffset, sizeof(dataOffset));
+
+    length = dataOffset + header.count() * header.elementSize;
+    map(true);
+    std::memcpy(address, &buffer[0], buffer.size());
+}
+
+DistanceFile::DistanceFile(const std::string &path, bool writable)
+    : path(path), dataOffset(0), length(0), address(NULL), writable(writable) {
+    map(false);
+
+    HeaderReader reader(address, length);
+    char fileMagic[sizeof(magic)];
+    uint32_t fileVersion;
+    uint64_t labelCount;
+    bool valid = reader.read(fileMagic, sizeof(fileMagic)) && std::memcmp(fileMagic, magic, sizeof(magic)) == 0 &&
+                 reader.read(&fileVersion, sizeof(fileVersion)) && fileVersion == version &&
+                 reader.read(&header.elementSize, sizeof(header.elementSize)) &&
+                 (header.elementSize == sizeof(double) || header.elementSize == sizeof(float)) &&
+                 reader.read(&header.size, sizeof(header.size)) && reader.read(&dataOffset, sizeof(dataOffset)) &&
+                 reader.read(&header.tileSize, sizeof(header.tileSize)) &&
+                 reader.read(&header.workItems, sizeof(header.workItems)) &&
+                 reader.read(&header.completed, sizeof(header.completed)) && reader.readString(header.method) &&
+                 reader.read(&labelCount, sizeof(labelCount)) &&
+                 (labelCount == 0 || labelCount == header.size);
+    for (uint64_t i = 0; valid && i < labelCount; i++) {
+        header.labels.push_back(std::string());
+        valid = reader.readString(header.labels.back());
+    }
+    if (!valid || dataOffset > length || header.count() > (length - dataOffset) / header.elementSize) {
+        unmap();
+        Rcpp::stop("File '" + path + "' is not a valid distance file.");
+    }
+}
+
+DistanceFile::~DistanceFile() {
+    unmap();
+}
+
+void DistanceFile::setProgress(uint64_t tileSize, uint64_t workItems, uint64_t completed) {
+    // the distances must reach the file before the progress covering them
+    flush();
+    header.tileSize = tileSize;
+    header.workItems = workItems;
+    header.completed = completed;
+    uint64_t progress[3] = {tileSize, workItems, completed};
+    std::memcpy(static_cast<char *>(address) + progressPosition, progress, sizeof(progress));
+    flush();
+}
+
+#ifdef _WIN32
+
+void DistanceFile::map(bool create) {
+    file = CreateFileA(path.c_str(), writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ, NULL,
+                       create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    mapping = NULL;
+    if (file == INVALID_HANDLE_VALUE) {
+        Rcpp::stop("Cannot open file '" + path + "'.");
+    }
+    if (!create) {
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            unmap();
+            Rcpp::stop("Cannot determine the size of file '" + path + "'.");
+        }
+        length = static_cast<std::size_t>(fileSize.QuadPart);
+    }
+    uint64_t mappingSize = length;
+    if (length > 0) {
+        mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                     static_cast<DWORD>(mappingSize >> 32),
+                                     static_cast<DWORD>(mappingSize & 0xFFFFFFFF), NULL);
+    }
+    if (mapping != NULL) {
+        address = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, length);
+    }
+    if (address == NULL) {
+        unmap();
+        Rcpp::stop("Cannot map file '" + path + "' into memory.");
+    }
+}
+
+void DistanceFile::unmap() {
+    if (address != NULL) {
+        UnmapViewOfFile(address);
+        address = NULL;
+    }
+    if (mapping != NULL) {
+        CloseHandle(mapping);
+        mapping = NULL;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+}
+
+void DistanceFile::flush() {
+    if (writable && address != NULL) {
+        FlushViewOfFile(address, length);
+        FlushFileBuffers(file);
+    }
+}
+
+#else
+
+void DistanceFile::map(bool create) {
+    file = open(path.c_str(), create ? (O_RDWR | O_CREAT | O_TRUNC) : (writable ? O_RDWR : O_RDONLY), 0644);
+    if (file < 0) {
+        Rcpp::stop("Cannot open file '" + path + "'.");
+    }
+    if (create) {
+        // the file is sparse until the distances are written
+        if (ftruncate(file, static_cast<off_t>(length)) != 0) {
+            unmap();
+            Rcpp::stop("Cannot allocate " + std::to_string(length) + " bytes for file '" + path + "'.");
+        }
+    } else {
+        struct stat status;
+        if (fstat(file, &status) != 0) {
+            unmap();
+            Rcpp::stop("Cannot determine the size of file '" + path + "'.");
+        }
+        length = static_cast<std::size_t>(status.st_size);
+    }
+    void *mapped = length > 0 ? mmap(NULL, length, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, file, 0)
+                              : MAP_FAILED;
+    if (mapped == MAP_FAILED) {
+        unmap();
+        Rcpp::stop("Cannot map file '" + path + "' into memory.");
+    }
+    address = mapped;
+}
+
+void DistanceFile::unmap() {
+    if (address != NULL) {
+        munmap(address, length);
+        address = NULL;
+    }
+    if (file >= 0) {
+        close(file);
+        file = -1;
+    }
+}
+
+void DistanceFile::flush() {
+    if (writable && address != NULL) {
+        msync(address, length, MS_SYNC);
+    }
+}
+
+#endif
@@ -0,0 +1,125 @@
+// DistanceFile.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef DISTANCEFILE_H_
+#define DISTANCEFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+//==============================
+// Distance file
+//==============================
+// Memory-mapped file holding a condensed distance vector. The file starts with a header giving the number of
+// observations, the element size of the stored distances, the progress of the calculation, the distance method
+// and the labels, followed by the distances in the order of a dist object. The data section is aligned to 64
+// bytes. The progress is updated after the distances it covers are written, so an interrupted calculation can
+// be resumed.
+class DistanceFile {
+  public:
+    struct Header {
+        uint64_t size;
+        // size of one stored distance in bytes (8 for double, 4 for float)
+        uint32_t elementSize;
+        // tile size and number of work items of the calculation (0 before it started) and its completed work items
+        uint64_t tileSize;
+        uint64_t workItems;
+        uint64_t completed;
+        std::string method;
+        std::vector<std::string> labels;
+
+        Header() : size(0), elementSize(sizeof(double)), tileSize(0), workItems(0), completed(0) {}
+
+        // number of stored distances
+        uint64_t count() const {
+            return size > 1 ? size * (size - 1) / 2 : 0;
+        }
+
+        // all distances are written
+        bool isComplete() const {
+            return tileSize > 0 && completed >= workItems;
+        }
+    };
+
+  private:
+    std::string path;
+    Header header;
+    uint64_t dataOffset;
+    std::size_t length;
+    void *address;
+    bool writable;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int file;
+#endif
+
+    void map(bool create);
+    void unmap();
+
+    DistanceFile(const DistanceFile &);
+    DistanceFile &operator=(const DistanceFile &);
+
+  public:
+    /**
+     Creates a file for the distances of a dataset and maps it writable
+     @param path path of the file, an existing file is replaced
+     @param header description of the stored distances
+     */
+    DistanceFile(const std::string &path, const Header &header);
+
+    /**
+     Opens an existing distance file
+     @param path path of the file
+     @param writable map the file writable to continue its calculation
+     */
+    explicit DistanceFile(const std::string &path, bool writable = false);
+
+    ~DistanceFile();
+
+    const Header &getHeader() const {
+        return header;
+    }
+
+    // start of the condensed distances
+    void *data() const {
+        return static_cast<char *>(address) + dataOffset;
+    }
+
+    // writes modified pages back to the file
+    void flush();
+
+    /**
+     Records the progress of the calculation, after the distances written so far are flushed
+     @param tileSize tile size of the calculation
+     @param workItems number of work items of the calculation
+     @param completed number of completed work items
+     */
+    void setProgress(uint64_t tileSize, uint64_t workItems, uint64_t completed);
+};
+
+#endif // DISTANCEFILE_H_
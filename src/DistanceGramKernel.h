@@ -0,0 +1,128 @@
+// DistanceGramKernel.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISTANCEGRAMKERNEL_H_
+#define DISTANCEGRAMKERNEL_H_
+
+#include "DistanceRowKernel.h"
+#include <vector>
+
+//==============================
+// Gram matrix distance
+//==============================
+// Generic block engine for distances that only depend on the inner products xy, xx and yy of two observations and
+// their number of elements len. If enabled, the inner products of a block pair are computed with a single matrix
+// product (dgemm or sgemm) and the implementation turns them into distances with
+//   bool gramDistance(double xy, double xx, double yy, uword len, double tolerance, double &dist)
+// which returns false if cancellation beyond the relative tolerance makes the result inaccurate. These pairs are
+// recomputed with the kernel.
+template <typename Implementation>
+class DistanceGramKernel : public DistanceRowKernel<Implementation> {
+  private:
+    bool gramEngine;
+
+    inline Implementation &impl() {
+        return *static_cast<Implementation *>(this);
+    }
+
+    // results closer than this relative tolerance to a cancellation point are recomputed exactly,
+    // single precision products need a wider margin
+    template <typename T> static double gramTolerance() {
+        return sizeof(T) == sizeof(float) ? 1e-2 : 1e-4;
+    }
+
+    template <typename T> static void squaredNorms(const arma::Mat<T> &block, T *norms) {
+        for (uword k = 0; k < block.n_cols; ++k) {
+            const T *x = block.colptr(k);
+            T sum = 0;
+            for (uword i = 0; i < block.n_rows; ++i) {
+                sum += x[i] * x[i];
+            }
+            norms[k] = sum;
+        }
+    }
+
+    template <typename T>
+    void gramBlockDistances(const T *rows, uword rowCount, const T *cols, uword colCount, uword len,
+                            T *const *out) {
+        if (!gramEngine) {
+            IDistance::calcBlockDistances(rows, rowCount, cols, colCount, len, out);
+            return;
+        }
+        // observations are the columns of the blocks
+        const arma::Mat<T> rowBlock(const_cast<T *>(rows), len, rowCount, false, true);
+        const arma::Mat<T> colBlock(const_cast<T *>(cols), len, colCount, false, true);
+        arma::Mat<T> gram = rowBlock.t() * colBlock;
+        std::vector<T> rowNorms(rowCount), colNorms(colCount);
+        squaredNorms(rowBlock, rowNorms.data());
+        squaredNorms(colBlock, colNorms.data());
+
+        Implementation &implementation = impl();
+        for (uword c = 0; c < colCount; ++c) {
+            const T *g = gram.colptr(c);
+            for (uword r = 0; r < rowCount; ++r) {
+                double dist;
+                if (implementation.gramDistance(g[r], rowNorms[r], colNorms[c], len, gramTolerance<T>(), dist)) {
+                    out[c][r] = static_cast<T>(dist);
+                } else {
+                    out[c][r] = implementation.kernel(rows + r * len, cols + c * len, len);
+                }
+            }
+        }
+    }
+
+  protected:
+    bool usesGramEngine() const {
+        return gramEngine;
+    }
+
+    // inner product of two observations
+    template <typename T> static T dot(const T *a, const T *b, uword len) {
+        T xy = 0;
+        for (uword i = 0; i < len; ++i) {
+            xy += a[i] * b[i];
+        }
+        return xy;
+    }
+
+  public:
+    explicit DistanceGramKernel(bool gramEngine) : gramEngine(gramEngine) {}
+
+    void calcBlockDistances(const double *rows, uword rowCount, const double *cols, uword colCount, uword len,
+                            double *const *out) {
+        gramBlockDistances(rows, rowCount, cols, colCount, len, out);
+    }
+
+    void calcBlockDistances(const float *rows, uword rowCount, const float *cols, uword colCount, uword len,
+                            float *const *out) {
+        gramBlockDistances(rows, rowCount, cols, colCount, len, out);
+    }
+
+    void calcBlockDistancesBounded(const double *rows, uword rowCount, const double *cols, uword colCount, uword len,
+                                   double bound, double *const *out) {
+        if (gramEngine) {
+            gramBlockDistances(rows, rowCount, cols, colCount, len, out);
+        } else {
+            DistanceRowKernel<Implementation>::calcBlockDistancesBounded(rows, rowCount, cols, colCount, len, bound,
+                                                                         out);
+        }
+    }
+};
+
+#endif // DISTANCEGRAMKERNEL_H_
@@ -0,0 +1,63 @@
+// DistanceOptions.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISTANCEOPTIONS_H_
+#define DISTANCEOPTIONS_H_
+
+#include "IDistance.h"
+#include <string>
+
+//==============================
+// Distance options
+//==============================
+// Plain description of a distance method and its arguments, the counterpart of the method and the additional
+// arguments of parDist. Text values use the names of the R interface.
+struct DistanceOptions {
+    // distance method, unknown names select the euclidean distance
+    std::string method;
+    // block engine of the inner product based distances, "pairwise" or "gemm"
+    std::string engine;
+
+    // exponent of the minkowski distance
+    double p;
+
+    // covariance matrix of the mahalanobis distance, estimated from the input matrix if empty
+    arma::mat cov;
+    // whether cov is already inverted
+    bool inverted;
+
+    // dtw: warping window, step pattern and normalization ("", "n", "n+m" or "path.length")
+    bool warpingWindow;
+    unsigned int windowSize;
+    std::string stepPattern;
+    std::string normMethod;
+
+    // user defined distance function of the method "custom"
+    funcPtr customFunction;
+
+    DistanceOptions()
+        : method("euclidean"), engine("pairwise"), p(2), inverted(false), warpingWindow(false), windowSize(0),
+          stepPattern("symmetric1"), customFunction(NULL) {}
+
+    explicit DistanceOptions(const std::string &method) : DistanceOptions() {
+        this->method = method;
+    }
+};
+
+#endif // DISTANCEOPTIONS_H_
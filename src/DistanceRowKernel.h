@@ -0,0 +1,153 @@
+// DistanceRowKernel.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISTANCEROWKERNEL_H_
+#define DISTANCEROWKERNEL_H_
+
+#include "IDistance.h"
+#include <limits>
+#include <stdexcept>
+
+//==============================
+// Row kernel distance
+//==============================
+// Generic implementation of the row interface. The implementation provides
+//   template <typename T> T kernel(const T *a, const T *b, uword len)
+// which is called without virtual dispatch, so the batched loop over a block is compiled once per metric and
+// element type (double or float). Metrics whose partial results never decrease additionally provide
+//   double boundedKernel(const double *a, const double *b, uword len, double bound)
+// which stops as soon as the partial result exceeds the bound. Metrics with per-observation terms like sums or
+// norms provide
+//   void prepare(double *x, uword len)
+// which rewrites an observation once, e.g. normalises it, and return true from preparesObservations. Their
+// kernels then take the prepared observations.
+template <typename Implementation>
+class DistanceRowKernel : public IDistance {
+  private:
+    inline Implementation &impl() {
+        return *static_cast<Implementation *>(this);
+    }
+
+    template <typename T> void rowDistances(const T *block, uword count, const T *b, uword len, T *out) {
+        Implementation &implementation = impl();
+        for (uword k = 0; k < count; ++k, block += len) {
+            out[k] = implementation.kernel(block, b, len);
+        }
+    }
+
+  protected:
+    // number of elements between two checks of the bound, so the inner loops of bounded kernels stay branch free
+    static const uword abandonChunk = 16;
+
+    // matrices of a list are compared element by element
+    static void checkSameSize(const arma::mat &A, const arma::mat &B) {
+        if (A.n_rows != B.n_rows || A.n_cols != B.n_cols) {
+            throw std::invalid_argument("Matrices of different size cannot be compared by this distance method.");
+        }
+    }
+
+    // smallest and largest element of column j of A and B, NaNs are skipped like by arma::min and arma::max
+    static void columnExtremes(const arma::mat &A, const arma::mat &B, uword j, double &smallest, double &largest) {
+        smallest = std::numeric_limits<double>::infinity();
+        largest = -std::numeric_limits<double>::infinity();
+        const double *a = A.colptr(j), *b = B.colptr(j);
+        for (uword i = 0; i < A.n_rows; ++i) {
+            smallest = a[i] < smallest ? a[i] : smallest;
+            largest = a[i] > largest ? a[i] : largest;
+        }
+        for (uword i = 0; i < B.n_rows; ++i) {
+            smallest = b[i] < smallest ? b[i] : smallest;
+            largest = b[i] > largest ? b[i] : largest;
+        }
+    }
+
+    // the kernel over all elements of two matrices of the same size, without temporaries
+    double elementwiseDistance(const arma::mat &A, const arma::mat &B) {
+        checkSameSize(A, B);
+        return impl().kernel(A.memptr(), B.memptr(), A.n_elem);
+    }
+
+    // scales an observation to a sum of one
+    static void normaliseSum(double *x, uword len) {
+        double sum = 0;
+        for (uword i = 0; i < len; ++i) {
+            sum += x[i];
+        }
+        for (uword i = 0; i < len; ++i) {
+            x[i] /= sum;
+        }
+    }
+
+    // scales an observation to a euclidean norm of one
+    static void normaliseNorm(double *x, uword len) {
+        double squared = 0;
+        for (uword i = 0; i < len; ++i) {
+            squared += x[i] * x[i];
+        }
+        double norm = std::sqrt(squared);
+        for (uword i = 0; i < len; ++i) {
+            x[i] /= norm;
+        }
+    }
+
+  public:
+    // default preparation keeping the observation unchanged
+    void prepare(double *, uword) {
+    }
+
+    void prepareObservations(double *observations, uword count, uword len) {
+        Implementation &implementation = impl();
+        for (uword k = 0; k < count; ++k, observations += len) {
+            implementation.prepare(observations, len);
+        }
+    }
+
+    // default bounded kernel without early abandoning
+    double boundedKernel(const double *a, const double *b, uword len, double) {
+        return impl().kernel(a, b, len);
+    }
+
+    void calcBlockDistancesBounded(const double *rows, uword rowCount, const double *cols, uword colCount, uword len,
+                                   double bound, double *const *out) {
+        Implementation &implementation = impl();
+        for (uword c = 0; c < colCount; ++c) {
+            for (uword r = 0; r < rowCount; ++r) {
+                out[c][r] = implementation.boundedKernel(rows + r * len, cols + c * len, len, bound);
+            }
+        }
+    }
+
+    double calcRowDistance(const double *a, const double *b, uword len) {
+        return impl().kernel(a, b, len);
+    }
+
+    float calcRowDistance(const float *a, const float *b, uword len) {
+        return impl().kernel(a, b, len);
+    }
+
+    void calcRowDistances(const double *block, uword count, const double *b, uword len, double *out) {
+        rowDistances(block, count, b, len, out);
+    }
+
+    void calcRowDistances(const float *block, uword count, const float *b, uword len, float *out) {
+        rowDistances(block, count, b, len, out);
+    }
+};
+
+#endif // DISTANCEROWKERNEL_H_
@@ -0,0 +1,100 @@
+// DistanceSparse.cpp
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#include "DistanceSparse.h"
+#include "DistanceFactory.h"
+#include "Util.h"
+
+#include <stdexcept>
+
+SparseObservations SparseObservations::fromColumns(uword n, uword len, const int *columnOffsets, const int *rows,
+                                                   const double *x) {
+    SparseObservations observations;
+    observations.n = n;
+    observations.len = len;
+    // count the nonzero elements of each row, then scatter the columns in ascending order into the rows
+    observations.offsets.assign(n + 1, 0);
+    for (uword c = 0; c < len; ++c) {
+        for (int e = columnOffsets[c]; e < columnOffsets[c + 1]; ++e) {
+            if (x[e] != 0) {
+                observations.offsets[rows[e] + 1]++;
+            }
+        }
+    }
+    for (uword k = 0; k < n; ++k) {
+        observations.offsets[k + 1] += observations.offsets[k];
+    }
+    observations.indices.resize(observations.offsets[n]);
+    observations.values.resize(observations.offsets[n]);
+    std::vector<uint64_t> next(observations.offsets.begin(), observations.offsets.end() - 1);
+    for (uword c = 0; c < len; ++c) {
+        for (int e = columnOffsets[c]; e < columnOffsets[c + 1]; ++e) {
+            if (x[e] != 0) {
+                uint64_t position = next[rows[e]]++;
+                observations.indices[position] = c;
+                observations.values[position] = x[e];
+            }
+        }
+    }
+    return observations;
+}
+
+SparseObservations SparseObservations::fromRows(uword n, uword len, const int *rowOffsets, const int *columns,
+                                                const double *x) {
+    SparseObservations observations;
+    observations.n = n;
+    observations.len = len;
+    observations.offsets.push_back(0);
+    for (uword k = 0; k < n; ++k) {
+        for (int e = rowOffsets[k]; e < rowOffsets[k + 1]; ++e) {
+            if (x[e] != 0) {
+                observations.indices.push_back(columns[e]);
+                observations.values.push_back(x[e]);
+            }
+        }
+        observations.offsets.push_back(observations.indices.size());
+    }
+    return observations;
+}
+
+std::shared_ptr<ISparseDistance> DistanceSparseFactory::createDistanceFunction(const DistanceOptions &options) {
+    using util::isEqualStr;
+
+    const std::string &distName = options.method;
+    if (isEqualStr(distName, "euclidean")) {
+        return std::make_shared<SparseEuclidean>();
+    } else if (isEqualStr(distName, "manhattan")) {
+        return std::make_shared<SparseManhattan>();
+    } else if (isEqualStr(distName, "bray")) {
+        return std::make_shared<SparseBray>();
+    } else if (isEqualStr(distName, "canberra")) {
+        return std::make_shared<SparseCanberra>();
+    } else if (isEqualStr(distName, "hamming")) {
+        return std::make_shared<SparseHamming>();
+    } else if (isEqualStr(distName, "cosine")) {
+        return std::make_shared<SparseCosine>();
+    }
+    std::shared_ptr<IDistance> distance = createBinaryMeasure(distName, false);
+    if (distance == NULL) {
+        throw std::invalid_argument("Sparse input is only supported by the methods euclidean, manhattan, cosine, "
+                                    "bray, canberra, hamming and the binary distance measures.");
+    }
+    IBinaryMeasure *measure = dynamic_cast<IBinaryMeasure *>(distance.get());
+    return std::make_shared<SparseBinary>(distance, measure);
+}
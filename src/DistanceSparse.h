@@ -0,0 +1,324 @@
+// DistanceSparse.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISTANCESPARSE_H_
+#define DISTANCESPARSE_H_
+
+#include "DistanceBinary.h"
+#include "DistanceOptions.h"
+#include "IDistance.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+//==============================
+// Sparse observations
+//==============================
+// Observations in compressed sparse row form: the nonzero elements of observation k are values[offsets[k]] to
+// values[offsets[k + 1] - 1] at the ascending positions indices[offsets[k]] to indices[offsets[k + 1] - 1] of an
+// observation of len elements. Explicitly stored zeros are dropped.
+struct SparseObservations {
+    uword n;
+    uword len;
+    std::vector<uint64_t> offsets;
+    std::vector<uword> indices;
+    std::vector<double> values;
+
+    /**
+     Observations from the compressed sparse columns of an n x len matrix, like the slots of a dgCMatrix
+     @param n number of observations (rows)
+     @param len number of elements of an observation (columns)
+     @param columnOffsets len + 1 offsets of the columns into rows and x
+     @param rows row of each stored element, ascending within a column
+     @param x value of each stored element
+     */
+    static SparseObservations fromColumns(uword n, uword len, const int *columnOffsets, const int *rows,
+                                          const double *x);
+
+    /**
+     Observations from the compressed sparse rows of an n x len matrix, like the slots of a dgRMatrix
+     @param n number of observations (rows)
+     @param len number of elements of an observation (columns)
+     @param rowOffsets n + 1 offsets of the rows into columns and x
+     @param columns column of each stored element, ascending within a row
+     @param x value of each stored element
+     */
+    static SparseObservations fromRows(uword n, uword len, const int *rowOffsets, const int *columns,
+                                       const double *x);
+};
+
+// nonzero elements of a single sparse observation
+struct SparseRow {
+    const uword *indices;
+    const double *values;
+    uword count;
+
+    SparseRow(const SparseObservations &observations, uword k)
+        : indices(observations.indices.data() + observations.offsets[k]),
+          values(observations.values.data() + observations.offsets[k]),
+          count(static_cast<uword>(observations.offsets[k + 1] - observations.offsets[k])) {}
+};
+
+//==============================
+// Sparse distance interface
+//==============================
+// Distance between two sparse observations. The implementations only visit the nonzero elements and give the
+// same result as the dense distance of the observations.
+class ISparseDistance {
+  public:
+    virtual ~ISparseDistance() {}
+
+    // prepares the nonzero values of an observation once, e.g. normalises them
+    virtual void prepare(double *values, uword count) {
+    }
+
+    /**
+     Distance between two prepared sparse observations
+     @param a first observation
+     @param b second observation
+     @param len number of elements of an observation, including the zeros
+     @return distance between a and b
+     */
+    virtual double calcDistance(const SparseRow &a, const SparseRow &b, uword len) = 0;
+};
+
+// Calls term(x, y) for every position where a or b is nonzero in ascending order, the other value is zero.
+// Positions where both are zero are skipped.
+template <typename Term> inline void mergeUnion(const SparseRow &a, const SparseRow &b, Term &term) {
+    uword i = 0, j = 0;
+    while (i < a.count && j < b.count) {
+        if (a.indices[i] < b.indices[j]) {
+            term(a.values[i++], 0.0);
+        } else if (b.indices[j] < a.indices[i]) {
+            term(0.0, b.values[j++]);
+        } else {
+            term(a.values[i++], b.values[j++]);
+        }
+    }
+    for (; i < a.count; ++i) {
+        term(a.values[i], 0.0);
+    }
+    for (; j < b.count; ++j) {
+        term(0.0, b.values[j]);
+    }
+}
+
+// Calls term(x, y) for every position where both a and b are nonzero in ascending order
+template <typename Term> inline void mergeIntersection(const SparseRow &a, const SparseRow &b, Term &term) {
+    uword i = 0, j = 0;
+    while (i < a.count && j < b.count) {
+        if (a.indices[i] < b.indices[j]) {
+            ++i;
+        } else if (b.indices[j] < a.indices[i]) {
+            ++j;
+        } else {
+            term(a.values[i++], b.values[j++]);
+        }
+    }
+}
+
+//=======================
+// Sparse euclidean
+//=======================
+class SparseEuclidean : public ISparseDistance {
+  private:
+    struct Term {
+        double sum;
+        void operator()(double x, double y) {
+            double diff = x - y;
+            sum += diff * diff;
+        }
+    };
+
+  public:
+    double calcDistance(const SparseRow &a, const SparseRow &b, uword) {
+        Term term = {0};
+        mergeUnion(a, b, term);
+        return std::sqrt(term.sum);
+    }
+};
+
+//=======================
+// Sparse manhattan
+//=======================
+class SparseManhattan : public ISparseDistance {
+  private:
+    struct Term {
+        double sum;
+        void operator()(double x, double y) {
+            sum += std::abs(x - y);
+        }
+    };
+
+  public:
+    double calcDistance(const SparseRow &a, const SparseRow &b, uword) {
+        Term term = {0};
+        mergeUnion(a, b, term);
+        return term.sum;
+    }
+};
+
+//=======================
+// Sparse bray
+//=======================
+class SparseBray : public ISparseDistance {
+  private:
+    struct Term {
+        double numerator;
+        double denominator;
+        void operator()(double x, double y) {
+            numerator += std::abs(x - y);
+            denominator += x + y;
+        }
+    };
+
+  public:
+    // sum_i |x_i - y_i| / sum_i (x_i + y_i)
+    double calcDistance(const SparseRow &a, const SparseRow &b, uword) {
+        Term term = {0, 0};
+        mergeUnion(a, b, term);
+        return term.numerator / term.denominator;
+    }
+};
+
+//=======================
+// Sparse canberra
+//=======================
+class SparseCanberra : public ISparseDistance {
+  private:
+    struct Term {
+        double sum;
+        uword notNanCount;
+        void operator()(double x, double y) {
+            double ratio = std::abs(x - y) / std::abs(x + y);
+            bool isNumber = !std::isnan(ratio);
+            sum += isNumber ? ratio : 0;
+            notNanCount += isNumber;
+        }
+    };
+
+  public:
+    // sum_i |x_i - y_i| / |x_i + y_i|, the terms of positions where both are zero are NaN
+    double calcDistance(const SparseRow &a, const SparseRow &b, uword len) {
+        Term term = {0, 0};
+        mergeUnion(a, b, term);
+        if (len - term.notNanCount > 0) {
+            return ((term.notNanCount + 1) / static_cast<double>(term.notNanCount)) * term.sum;
+        }
+        return term.sum;
+    }
+};
+
+//=======================
+// Sparse hamming
+//=======================
+class SparseHamming : public ISparseDistance {
+  private:
+    struct Term {
+        uword mismatches;
+        void operator()(double x, double y) {
+            mismatches += x != y;
+        }
+    };
+
+  public:
+    double calcDistance(const SparseRow &a, const SparseRow &b, uword len) {
+        Term term = {0};
+        mergeUnion(a, b, term);
+        return term.mismatches / static_cast<double>(len);
+    }
+};
+
+//=======================
+// Sparse cosine
+//=======================
+class SparseCosine : public ISparseDistance {
+  private:
+    struct Term {
+        double dot;
+        void operator()(double x, double y) {
+            dot += x * y;
+        }
+    };
+
+  public:
+    // x_i / sqrt(sum_i x_i^2)
+    void prepare(double *values, uword count) {
+        double squared = 0;
+        for (uword i = 0; i < count; ++i) {
+            squared += values[i] * values[i];
+        }
+        double norm = std::sqrt(squared);
+        for (uword i = 0; i < count; ++i) {
+            values[i] /= norm;
+        }
+    }
+    double calcDistance(const SparseRow &a, const SparseRow &b, uword) {
+        // observations without nonzero elements have no direction, like the NaN of their dense normalisation
+        if (a.count == 0 || b.count == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        Term term = {0};
+        mergeIntersection(a, b, term);
+        return 1.0 - term.dot;
+    }
+};
+
+//=======================
+// Sparse binary measures
+//=======================
+// The number of positions where both are nonzero gives the contingency counts with the numbers of nonzero elements
+class SparseBinary : public ISparseDistance {
+  private:
+    struct Term {
+        uint64_t both;
+        void operator()(double, double) {
+            ++both;
+        }
+    };
+
+    // keeps the measure alive
+    std::shared_ptr<IDistance> distance;
+    IBinaryMeasure *measure;
+
+  public:
+    SparseBinary(const std::shared_ptr<IDistance> &distance, IBinaryMeasure *measure)
+        : distance(distance), measure(measure) {}
+
+    double calcDistance(const SparseRow &a, const SparseRow &b, uword len) {
+        Term term = {0};
+        mergeIntersection(a, b, term);
+        uint64_t both = term.both;
+        return measure->calcMeasure(BinaryCount(both, a.count - both, b.count - both, len - a.count - b.count + both),
+                                    len);
+    }
+};
+
+//==============================
+// Distance Sparse Factory
+//==============================
+class DistanceSparseFactory {
+  public:
+    // throws std::invalid_argument for methods without a sparse implementation
+    std::shared_ptr<ISparseDistance> createDistanceFunction(const DistanceOptions &options);
+};
+
+#endif // DISTANCESPARSE_H_
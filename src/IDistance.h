@@ -20,7 +20,7 @@
 #ifndef IDISTANCE_H_
 #define IDISTANCE_H_
 
-#include <RcppArmadillo.h>
+#include "CoreBackend.h"
 
 using arma::mat;
 using arma::Mat;
@@ -28,28 +28,135 @@ using arma::uword;
 
 typedef double (*funcPtr)(const mat &A, const mat &B);
 
-template <typename T>
-Mat<T> colwise_max_idx(const Mat<T> &A) {
-    Mat<T> res = mat(1, A.n_cols);
-    for (uword i = 0; i != A.n_cols; ++i) {
-        res.at(0, i) = A.col(i).max();
-    }
-    return res;
-}
-
-template <typename T>
-Mat<T> colwise_min_idx(const Mat<T> &A) {
-    Mat<T> res = mat(1, A.n_cols);
-    for (uword i = 0; i != A.n_cols; ++i) {
-        res.at(0, i) = A.col(i).min();
-    }
-    return res;
-}
-
 class IDistance {
   public:
     virtual ~IDistance() {}
     virtual double calcDistance(const mat &A, const mat &B) = 0;
+
+    // whether prepareObservations changes the observations
+    virtual bool preparesObservations() {
+        return false;
+    }
+
+    // whether prepareObservations replaces the values by packed data, which is copied and not converted to single
+    // precision; it fits into the first 4 bytes per element of an observation
+    virtual bool packsObservations() {
+        return false;
+    }
+
+    /**
+     Prepares contiguous observations once before their row distances are calculated, e.g. scales every observation
+     by its sum or norm, so the row distances do not recompute it for each pair. calcRowDistance(s),
+     calcBlockDistances and calcBlockDistancesBounded take prepared observations, single precision observations are
+     prepared in double precision before the conversion. calcDistance takes the original observations.
+     The default keeps the observations unchanged.
+     @param observations first observation, observations are stored one after another
+     @param count number of observations
+     @param len number of elements of an observation
+     */
+    virtual void prepareObservations(double *observations, uword count, uword len) {
+    }
+
+    /**
+     Distance between two observations stored as contiguous arrays, e.g. columns of a transposed input matrix.
+     The default wraps the memory into row vectors without copying and calls calcDistance.
+     @param a first observation
+     @param b second observation
+     @param len number of elements of an observation
+     @return distance between a and b
+     */
+    virtual double calcRowDistance(const double *a, const double *b, uword len) {
+        const mat A(const_cast<double *>(a), 1, len, false, true);
+        const mat B(const_cast<double *>(b), 1, len, false, true);
+        return calcDistance(A, B);
+    }
+
+    /**
+     Distances between a block of consecutive observations and a single observation,
+     out[k] is the distance between the k-th observation of the block and b.
+     The default calls calcRowDistance for every observation of the block.
+     @param block first observation of the block, observations are stored one after another
+     @param count number of observations in the block
+     @param b observation
+     @param len number of elements of an observation
+     @param out output array of length count
+     */
+    virtual void calcRowDistances(const double *block, uword count, const double *b, uword len, double *out) {
+        for (uword k = 0; k < count; ++k, block += len) {
+            out[k] = calcRowDistance(block, b, len);
+        }
+    }
+
+    /**
+     Distances between two blocks of consecutive observations, out[c][r] is the distance between the r-th
+     observation of rows and the c-th observation of cols.
+     The default calls calcRowDistances for every observation of cols.
+     @param rows first observation of the row block
+     @param rowCount number of observations in the row block
+     @param cols first observation of the column block
+     @param colCount number of observations in the column block
+     @param len number of elements of an observation
+     @param out colCount output arrays of length rowCount
+     */
+    virtual void calcBlockDistances(const double *rows, uword rowCount, const double *cols, uword colCount,
+                                    uword len, double *const *out) {
+        for (uword c = 0; c < colCount; ++c, cols += len) {
+            calcRowDistances(rows, rowCount, cols, len, out[c]);
+        }
+    }
+
+    /**
+     Distance between A and B for callers that are only interested in distances up to a bound, e.g. radius queries.
+     Implementations may abandon the calculation once the distance is known to exceed the bound and return any
+     value greater than the bound. The default calls calcDistance.
+     @param A first observation
+     @param B second observation
+     @param bound largest distance of interest
+     @return distance between A and B, or a value greater than bound
+     */
+    virtual double calcDistanceBounded(const mat &A, const mat &B, double bound) {
+        return calcDistance(A, B);
+    }
+
+    /**
+     Bounded variant of calcBlockDistances, distances greater than the bound may be replaced by any value greater
+     than the bound. The default calls calcDistanceBounded for every pair.
+     */
+    virtual void calcBlockDistancesBounded(const double *rows, uword rowCount, const double *cols, uword colCount,
+                                           uword len, double bound, double *const *out) {
+        for (uword c = 0; c < colCount; ++c) {
+            const mat B(const_cast<double *>(cols + c * len), 1, len, false, true);
+            for (uword r = 0; r < rowCount; ++r) {
+                const mat A(const_cast<double *>(rows + r * len), 1, len, false, true);
+                out[c][r] = calcDistanceBounded(A, B, bound);
+            }
+        }
+    }
+
+    /**
+     Single precision variant of calcRowDistance.
+     The default widens both observations to double precision and calls calcDistance.
+     */
+    virtual float calcRowDistance(const float *a, const float *b, uword len) {
+        const mat A = arma::conv_to<mat>::from(arma::fmat(const_cast<float *>(a), 1, len, false, true));
+        const mat B = arma::conv_to<mat>::from(arma::fmat(const_cast<float *>(b), 1, len, false, true));
+        return static_cast<float>(calcDistance(A, B));
+    }
+
+    // Single precision variant of calcRowDistances
+    virtual void calcRowDistances(const float *block, uword count, const float *b, uword len, float *out) {
+        for (uword k = 0; k < count; ++k, block += len) {
+            out[k] = calcRowDistance(block, b, len);
+        }
+    }
+
+    // Single precision variant of calcBlockDistances
+    virtual void calcBlockDistances(const float *rows, uword rowCount, const float *cols, uword colCount,
+                                    uword len, float *const *out) {
+        for (uword c = 0; c < colCount; ++c, cols += len) {
+            calcRowDistances(rows, rowCount, cols, len, out[c]);
+        }
+    }
 };
 
 #endif // IDISTANCE_H_
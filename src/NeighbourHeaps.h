@@ -0,0 +1,121 @@
+// NeighbourHeaps.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef NEIGHBOURHEAPS_H_
+#define NEIGHBOURHEAPS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//==============================
+// Neighbour heaps
+//==============================
+// Bounded max-heaps holding the k nearest neighbours of each of n observations. Neighbours are ordered by
+// distance and then by index, NaN distances rank behind all others, so the result does not depend on the
+// order in which the pairs are offered.
+class NeighbourHeaps {
+  public:
+    typedef std::pair<double, uint64_t> Neighbour;
+
+  private:
+    uint64_t n;
+    uint64_t k;
+    // heap of observation i is stored in [i * k, i * k + counts[i])
+    std::vector<Neighbour> neighbours;
+    std::vector<uint64_t> counts;
+
+    struct Closer {
+        bool operator()(const Neighbour &a, const Neighbour &b) const {
+            bool aNaN = std::isnan(a.first);
+            bool bNaN = std::isnan(b.first);
+            if (aNaN != bNaN) {
+                return bNaN;
+            }
+            if (!aNaN && a.first != b.first) {
+                return a.first < b.first;
+            }
+            return a.second < b.second;
+        }
+    };
+
+  public:
+    NeighbourHeaps(uint64_t n, uint64_t k) : n(n), k(k) {}
+
+    /**
+     Offers a neighbour to an observation and keeps it if it is one of the k nearest so far
+     @param i index of the observation
+     @param neighbour index of the neighbour
+     @param distance distance between both observations
+     */
+    inline void offer(uint64_t i, uint64_t neighbour, double distance) {
+        if (k == 0) {
+            return;
+        }
+        if (neighbours.empty()) {
+            // allocated on first use, as split bodies without work never need it
+            neighbours.resize(n * k);
+            counts.assign(n, 0);
+        }
+        Neighbour candidate(distance, neighbour);
+        Neighbour *heap = &neighbours[i * k];
+        uint64_t &count = counts[i];
+        Closer closer;
+        if (count < k) {
+            heap[count++] = candidate;
+            std::push_heap(heap, heap + count, closer);
+        } else if (closer(candidate, heap[0])) {
+            std::pop_heap(heap, heap + k, closer);
+            heap[k - 1] = candidate;
+            std::push_heap(heap, heap + k, closer);
+        }
+    }
+
+    // merges the neighbours found by another set of heaps
+    void merge(const NeighbourHeaps &other) {
+        if (other.neighbours.empty()) {
+            return;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            const Neighbour *heap = &other.neighbours[i * k];
+            for (uint64_t c = 0; c < other.counts[i]; c++) {
+                offer(i, heap[c].second, heap[c].first);
+            }
+        }
+    }
+
+    /**
+     Sorted neighbours of an observation
+     @param i index of the observation
+     @return the neighbours with increasing distance
+     */
+    std::vector<Neighbour> sorted(uint64_t i) const {
+        if (neighbours.empty()) {
+            return std::vector<Neighbour>();
+        }
+        std::vector<Neighbour> result(neighbours.begin() + i * k, neighbours.begin() + i * k + counts[i]);
+        std::sort(result.begin(), result.end(), Closer());
+        return result;
+    }
+};
+
+#endif // NEIGHBOURHEAPS_H_
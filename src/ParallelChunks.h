@@ -0,0 +1,169 @@
+// ParallelChunks.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PARALLELCHUNKS_H_
+#define PARALLELCHUNKS_H_
+
+#include "CoreBackend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+#include "Profile.h"
+#include "Tiling.h"
+
+//==============================
+// Progress
+//==============================
+// Thrown by the default Progress when a calculation is interrupted
+class CalculationInterrupted : public std::runtime_error {
+  public:
+    CalculationInterrupted() : std::runtime_error("Calculation interrupted.") {}
+};
+
+// Record of the completed work items of a tiling. The work items are completed in order, so the record is a
+// single count. The default keeps no record, every calculation starts from the beginning and is never
+// interrupted.
+class Progress {
+  public:
+    virtual ~Progress() {}
+
+    /**
+     Called before the calculation starts
+     @param tiling tiling of the calculation
+     @return number of work items completed by an earlier run with the same tiling
+     */
+    virtual uint64_t start(const TriangularTiling &) {
+        return 0;
+    }
+
+    /**
+     Called after each chunk
+     @param completed number of completed work items, the distances of these items are written
+     */
+    virtual void completed(uint64_t) {}
+
+    /**
+     Called on the calling thread between work items and after each chunk
+     @return whether the calculation is to be interrupted
+     */
+    virtual bool interruptPending() {
+        return false;
+    }
+
+    // Called once the calculation is interrupted, must throw
+    virtual void interrupt() {
+        throw CalculationInterrupted();
+    }
+};
+
+//==============================
+// Chunked parallel for
+//==============================
+namespace chunks {
+
+// chunks per calculation, every chunk ends with a checkpoint and an interrupt check
+const uint64_t chunkCount = 100;
+// smallest chunk, enough work items to keep all threads busy
+const uint64_t minChunkSize = 128;
+
+// Processes the work items of a worker one by one until the calculation is cancelled. The main thread takes
+// part in the parallel loop and checks for interrupts between its work items. With a profile, the time and the
+// pairs of every work item are recorded.
+template <typename Worker> struct InterruptibleWorker : public backend::Worker {
+    Worker &worker;
+    const TriangularTiling &tiling;
+    Progress &progress;
+    std::atomic<bool> &cancelled;
+    Profile *profile;
+    std::thread::id mainThread;
+
+    InterruptibleWorker(Worker &worker, const TriangularTiling &tiling, Progress &progress,
+                        std::atomic<bool> &cancelled, Profile *profile)
+        : worker(worker), tiling(tiling), progress(progress), cancelled(cancelled), profile(profile),
+          mainThread(std::this_thread::get_id()) {}
+
+    void operator()(std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; k++) {
+            if (cancelled) {
+                return;
+            }
+            if (std::this_thread::get_id() == mainThread && progress.interruptPending()) {
+                cancelled = true;
+                return;
+            }
+            if (profile == NULL) {
+                worker(k, k + 1);
+                continue;
+            }
+            Profile::Clock::time_point start = Profile::Clock::now();
+            worker(k, k + 1);
+            double seconds = Profile::secondsSince(start);
+            Tile tiles[2];
+            unsigned int tileCount = tiling.getTiles(k, tiles);
+            uint64_t pairs = 0;
+            for (unsigned int t = 0; t < tileCount; t++) {
+                pairs += tiles[t].pairCount();
+            }
+            profile->addWorkItem(seconds, tileCount, pairs);
+        }
+    }
+};
+
+} // namespace chunks
+
+/**
+ Runs the work items of a tiling in chunks of parallel loops. Completed chunks are reported to the progress
+ record, work items completed by an earlier run are skipped. An interrupt of the progress record cancels the
+ remaining work items of the current chunk and ends the calculation with Progress::interrupt.
+ @param worker worker processing single work items
+ @param tiling tiling of the calculation
+ @param progress record of the completed work items
+ @param profile optional profile of the calculation
+ */
+template <typename Worker>
+void chunkedParallelFor(Worker &worker, const TriangularTiling &tiling, Progress &progress, Profile *profile = NULL) {
+    uint64_t end = tiling.size();
+    uint64_t begin = std::min(progress.start(tiling), end);
+    uint64_t chunkSize = std::max(chunks::minChunkSize, (end + chunks::chunkCount - 1) / chunks::chunkCount);
+
+    std::atomic<bool> cancelled(false);
+    chunks::InterruptibleWorker<Worker> interruptible(worker, tiling, progress, cancelled, profile);
+    ProfilePhase phase(profile, "distances");
+    for (uint64_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize) {
+        uint64_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+        Profile::Clock::time_point chunkStart = Profile::Clock::now();
+        // single work items let the scheduler steal work at tile granularity
+        backend::parallelFor(chunkBegin, chunkEnd, interruptible, 1);
+        if (profile != NULL) {
+            profile->addParallelLoop(Profile::secondsSince(chunkStart));
+        }
+        if (!cancelled) {
+            progress.completed(chunkEnd);
+        }
+        if (cancelled || progress.interruptPending()) {
+            progress.interrupt();
+        }
+    }
+}
+
+#endif // PARALLELCHUNKS_H_
@@ -0,0 +1,71 @@
+// PreparedDataset.cpp
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#include "PreparedDataset.h"
+
+#include <stdexcept>
+
+#include "DistanceCore.h"
+#include "DistanceFactory.h"
+
+PreparedDataset::PreparedDataset(const arma::mat &dataMatrix, const DistanceOptions &options)
+    : isDataMatrix(true), distance(DistanceFactory(dataMatrix).createDistanceFunction(options)) {
+    observations = rowObservations(dataMatrix, *distance);
+}
+
+PreparedDataset::PreparedDataset(const std::vector<arma::mat> &dataMatrixList, const DistanceOptions &options)
+    : isDataMatrix(false), dataMatrixList(dataMatrixList),
+      distance(DistanceFactory(dataMatrixList).createDistanceFunction(options)) {}
+
+void PreparedDataset::checkQuery(const arma::mat &queries) const {
+    if (!isDataMatrix) {
+        throw std::invalid_argument("The reference observations are a list of matrices, queries must be as well.");
+    }
+    if (queries.n_cols != observations.n_rows) {
+        throw std::invalid_argument("Queries must have the same number of columns as the reference observations.");
+    }
+}
+
+void PreparedDataset::checkQuery(const std::vector<arma::mat> &) const {
+    if (isDataMatrix) {
+        throw std::invalid_argument("The reference observations are the rows of a matrix, queries must be as well.");
+    }
+}
+
+void PreparedDataset::crossDistances(const arma::mat &queries, double *output) const {
+    checkQuery(queries);
+    arma::mat queryObservations = rowObservations(queries, *distance);
+    calcCrossDistObservations(queryObservations, observations, distance, output);
+}
+
+void PreparedDataset::crossDistances(const std::vector<arma::mat> &queries, double *output) const {
+    checkQuery(queries);
+    calcCrossDistVec(queries, dataMatrixList, distance, output);
+}
+
+NeighbourHeaps PreparedDataset::nearestNeighbours(const arma::mat &queries, uint64_t k) const {
+    checkQuery(queries);
+    arma::mat queryObservations = rowObservations(queries, *distance);
+    return calcQueryKnnObservations(queryObservations, observations, distance, k);
+}
+
+NeighbourHeaps PreparedDataset::nearestNeighbours(const std::vector<arma::mat> &queries, uint64_t k) const {
+    checkQuery(queries);
+    return calcQueryKnnVec(queries, dataMatrixList, distance, k);
+}
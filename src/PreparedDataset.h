@@ -0,0 +1,103 @@
+// PreparedDataset.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PREPAREDDATASET_H_
+#define PREPAREDDATASET_H_
+
+#include "CoreBackend.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DistanceOptions.h"
+#include "IDistance.h"
+#include "NeighbourHeaps.h"
+
+//==============================
+// Prepared dataset
+//==============================
+// Reference observations kept resident for repeated queries. The distance function including its dataset
+// dependent precalculations (like the inverted covariance matrix of mahalanobis) is created once, matrix input
+// is stored transposed and prepared for the row distances, so every reference observation is contiguous.
+// Queries only convert, transpose and prepare themselves, small queries run on the calling thread. Queries may
+// run concurrently.
+class PreparedDataset {
+  private:
+    bool isDataMatrix;
+    // reference rows of matrix input as columns
+    arma::mat observations;
+    // reference matrices of list input
+    std::vector<arma::mat> dataMatrixList;
+    std::shared_ptr<IDistance> distance;
+
+    void checkQuery(const arma::mat &queries) const;
+    void checkQuery(const std::vector<arma::mat> &queries) const;
+
+  public:
+    PreparedDataset(const arma::mat &dataMatrix, const DistanceOptions &options);
+    PreparedDataset(const std::vector<arma::mat> &dataMatrixList, const DistanceOptions &options);
+
+    // whether the reference observations are the rows of a matrix
+    bool matrixInput() const {
+        return isDataMatrix;
+    }
+
+    // number of reference observations
+    uint64_t size() const {
+        return isDataMatrix ? observations.n_cols : dataMatrixList.size();
+    }
+
+    // number of columns of matrix input
+    uint64_t dimensions() const {
+        return isDataMatrix ? observations.n_rows : 0;
+    }
+
+    /**
+     Distances between query rows and all reference observations
+     @param queries matrix with a query per row
+     @param output column-major queries.n_rows x size() matrix
+     */
+    void crossDistances(const arma::mat &queries, double *output) const;
+
+    /**
+     Distances between query matrices and all reference observations
+     @param queries list of query matrices
+     @param output column-major queries.size() x size() matrix
+     */
+    void crossDistances(const std::vector<arma::mat> &queries, double *output) const;
+
+    /**
+     k nearest reference observations of each query row
+     @param queries matrix with a query per row
+     @param k number of neighbours
+     @return neighbours of every query, indices refer to the reference observations
+     */
+    NeighbourHeaps nearestNeighbours(const arma::mat &queries, uint64_t k) const;
+
+    /**
+     k nearest reference observations of each query matrix
+     @param queries list of query matrices
+     @param k number of neighbours
+     @return neighbours of every query, indices refer to the reference observations
+     */
+    NeighbourHeaps nearestNeighbours(const std::vector<arma::mat> &queries, uint64_t k) const;
+};
+
+#endif // PREPAREDDATASET_H_
@@ -0,0 +1,156 @@
+// Profile.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//==============================
+// Profile
+//==============================
+// Opt-in record of where the time of a distance calculation goes: wall time and allocated bytes of its phases,
+// and busy time, work items, tiles and distance pairs of every thread taking part in the parallel loop. The
+// idle time of a thread is the wall time of the parallel loop it was not busy with work items.
+class Profile {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    static double secondsSince(const Clock::time_point &start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    struct Phase {
+        std::string name;
+        double seconds;
+        double bytes;
+    };
+
+    struct ThreadStats {
+        double busy;
+        uint64_t workItems;
+        uint64_t tiles;
+        uint64_t pairs;
+
+        ThreadStats() : busy(0), workItems(0), tiles(0), pairs(0) {}
+    };
+
+  private:
+    std::vector<Phase> phases;
+    double totalSeconds;
+    double parallelSeconds;
+    uint64_t chunks;
+    // threads in the order of their first work item
+    std::map<std::thread::id, std::size_t> threadIndex;
+    std::vector<ThreadStats> threads;
+    std::mutex mutex;
+
+  public:
+    Profile() : totalSeconds(0), parallelSeconds(0), chunks(0) {}
+
+    // wall time of the whole calculation
+    void setTotal(double seconds) {
+        totalSeconds = seconds;
+    }
+
+    void addPhase(const std::string &name, double seconds, double bytes) {
+        Phase phase = {name, seconds, bytes};
+        phases.push_back(phase);
+    }
+
+    // wall time of the parallel loops, the reference for the idle time of the threads
+    void addParallelLoop(double seconds) {
+        parallelSeconds += seconds;
+        chunks++;
+    }
+
+    // called by the threads of the parallel loop after every work item
+    void addWorkItem(double seconds, uint64_t tiles, uint64_t pairs) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::thread::id id = std::this_thread::get_id();
+        std::map<std::thread::id, std::size_t>::iterator it = threadIndex.find(id);
+        if (it == threadIndex.end()) {
+            it = threadIndex.insert(std::make_pair(id, threads.size())).first;
+            threads.push_back(ThreadStats());
+        }
+        ThreadStats &stats = threads[it->second];
+        stats.busy += seconds;
+        stats.workItems++;
+        stats.tiles += tiles;
+        stats.pairs += pairs;
+    }
+
+    double getTotal() const {
+        return totalSeconds;
+    }
+
+    double getParallelSeconds() const {
+        return parallelSeconds;
+    }
+
+    uint64_t getChunks() const {
+        return chunks;
+    }
+
+    const std::vector<Phase> &getPhases() const {
+        return phases;
+    }
+
+    const std::vector<ThreadStats> &getThreads() const {
+        return threads;
+    }
+};
+
+// Measures a phase of a calculation from construction to destruction, does nothing without a profile
+class ProfilePhase {
+  private:
+    Profile *profile;
+    std::string name;
+    double bytes;
+    Profile::Clock::time_point start;
+
+    ProfilePhase(const ProfilePhase &);
+    ProfilePhase &operator=(const ProfilePhase &);
+
+  public:
+    ProfilePhase(Profile *profile, const std::string &name) : profile(profile), name(name), bytes(0) {
+        if (profile != NULL) {
+            start = Profile::Clock::now();
+        }
+    }
+
+    ~ProfilePhase() {
+        if (profile != NULL) {
+            profile->addPhase(name, Profile::secondsSince(start), bytes);
+        }
+    }
+
+    // memory allocated by the phase
+    void allocated(double bytes) {
+        this->bytes += bytes;
+    }
+};
+
+#endif // PROFILE_H_
@@ -25,15 +25,228 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_parallelDistMatrixVec
-Rcpp::NumericVector cpp_parallelDistMatrixVec(arma::mat dataMatrix, Rcpp::List attrs, Rcpp::List arguments);
-RcppExport SEXP _parallelDist_cpp_parallelDistMatrixVec(SEXP dataMatrixSEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+Rcpp::NumericVector cpp_parallelDistMatrixVec(SEXP x, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_parallelDistMatrixVec(SEXP xSEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< arma::mat >::type dataMatrix(dataMatrixSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
     Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
     Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_parallelDistMatrixVec(dataMatrix, attrs, arguments));
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelDistMatrixVec(x, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelBinaryDistMatrix
+Rcpp::List cpp_parallelBinaryDistMatrix(const arma::mat& dataMatrix, Rcpp::List attrs, Rcpp::CharacterVector methods);
+RcppExport SEXP _parallelDist_cpp_parallelBinaryDistMatrix(SEXP dataMatrixSEXP, SEXP attrsSEXP, SEXP methodsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type dataMatrix(dataMatrixSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type methods(methodsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelBinaryDistMatrix(dataMatrix, attrs, methods));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelDistSparse
+Rcpp::NumericVector cpp_parallelDistSparse(Rcpp::IntegerVector p, Rcpp::IntegerVector indices, Rcpp::NumericVector x, Rcpp::IntegerVector dim, bool byRow, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_parallelDistSparse(SEXP pSEXP, SEXP indicesSEXP, SEXP xSEXP, SEXP dimSEXP, SEXP byRowSEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type p(pSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type indices(indicesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type dim(dimSEXP);
+    Rcpp::traits::input_parameter< bool >::type byRow(byRowSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelDistSparse(p, indices, x, dim, byRow, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelDistAppend
+Rcpp::NumericVector cpp_parallelDistAppend(Rcpp::NumericVector d, SEXP x, SEXP y, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_parallelDistAppend(SEXP dSEXP, SEXP xSEXP, SEXP ySEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type d(dSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type y(ySEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelDistAppend(d, x, y, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelCrossDist
+Rcpp::NumericMatrix cpp_parallelCrossDist(SEXP x, SEXP y, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_parallelCrossDist(SEXP xSEXP, SEXP ySEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type y(ySEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelCrossDist(x, y, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelKnn
+Rcpp::List cpp_parallelKnn(SEXP x, int k, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_parallelKnn(SEXP xSEXP, SEXP kSEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelKnn(x, k, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelDistFloat
+Rcpp::RawVector cpp_parallelDistFloat(SEXP x, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_parallelDistFloat(SEXP xSEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelDistFloat(x, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelDistProfile
+SEXP cpp_parallelDistProfile(SEXP x, Rcpp::List attrs, Rcpp::List arguments, bool singlePrecision);
+RcppExport SEXP _parallelDist_cpp_parallelDistProfile(SEXP xSEXP, SEXP attrsSEXP, SEXP argumentsSEXP, SEXP singlePrecisionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    Rcpp::traits::input_parameter< bool >::type singlePrecision(singlePrecisionSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelDistProfile(x, attrs, arguments, singlePrecision));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_floatToDouble
+Rcpp::NumericVector cpp_floatToDouble(Rcpp::RawVector packed);
+RcppExport SEXP _parallelDist_cpp_floatToDouble(SEXP packedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RawVector >::type packed(packedSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_floatToDouble(packed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelDistFile
+void cpp_parallelDistFile(SEXP x, Rcpp::List attrs, Rcpp::List arguments, std::string path, bool singlePrecision, bool resume);
+RcppExport SEXP _parallelDist_cpp_parallelDistFile(SEXP xSEXP, SEXP attrsSEXP, SEXP argumentsSEXP, SEXP pathSEXP, SEXP singlePrecisionSEXP, SEXP resumeSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< bool >::type singlePrecision(singlePrecisionSEXP);
+    Rcpp::traits::input_parameter< bool >::type resume(resumeSEXP);
+    cpp_parallelDistFile(x, attrs, arguments, path, singlePrecision, resume);
+    return R_NilValue;
+END_RCPP
+}
+// cpp_distFileInfo
+Rcpp::List cpp_distFileInfo(std::string path);
+RcppExport SEXP _parallelDist_cpp_distFileInfo(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_distFileInfo(path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_distFileRead
+Rcpp::NumericMatrix cpp_distFileRead(std::string path, Rcpp::IntegerVector rows, Rcpp::IntegerVector cols);
+RcppExport SEXP _parallelDist_cpp_distFileRead(SEXP pathSEXP, SEXP rowsSEXP, SEXP colsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type rows(rowsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type cols(colsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_distFileRead(path, rows, cols));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_distFileVector
+Rcpp::NumericVector cpp_distFileVector(std::string path);
+RcppExport SEXP _parallelDist_cpp_distFileVector(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_distFileVector(path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_parallelRadius
+Rcpp::List cpp_parallelRadius(SEXP x, double radius, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_parallelRadius(SEXP xSEXP, SEXP radiusSEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type radius(radiusSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_parallelRadius(x, radius, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_prepareDist
+SEXP cpp_prepareDist(SEXP x, Rcpp::List attrs, Rcpp::List arguments);
+RcppExport SEXP _parallelDist_cpp_prepareDist(SEXP xSEXP, SEXP attrsSEXP, SEXP argumentsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type attrs(attrsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type arguments(argumentsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_prepareDist(x, attrs, arguments));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_preparedCrossDist
+Rcpp::NumericMatrix cpp_preparedCrossDist(SEXP prepared, SEXP x);
+RcppExport SEXP _parallelDist_cpp_preparedCrossDist(SEXP preparedSEXP, SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type prepared(preparedSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_preparedCrossDist(prepared, x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_preparedKnn
+Rcpp::List cpp_preparedKnn(SEXP prepared, SEXP x, int k);
+RcppExport SEXP _parallelDist_cpp_preparedKnn(SEXP preparedSEXP, SEXP xSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type prepared(preparedSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_preparedKnn(prepared, x, k));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -41,6 +254,22 @@ END_RCPP
 static const R_CallMethodDef CallEntries[] = {
     {"_parallelDist_cpp_parallelDistVec", (DL_FUNC) &_parallelDist_cpp_parallelDistVec, 3},
     {"_parallelDist_cpp_parallelDistMatrixVec", (DL_FUNC) &_parallelDist_cpp_parallelDistMatrixVec, 3},
+    {"_parallelDist_cpp_parallelBinaryDistMatrix", (DL_FUNC) &_parallelDist_cpp_parallelBinaryDistMatrix, 3},
+    {"_parallelDist_cpp_parallelDistSparse", (DL_FUNC) &_parallelDist_cpp_parallelDistSparse, 7},
+    {"_parallelDist_cpp_parallelDistAppend", (DL_FUNC) &_parallelDist_cpp_parallelDistAppend, 5},
+    {"_parallelDist_cpp_parallelCrossDist", (DL_FUNC) &_parallelDist_cpp_parallelCrossDist, 4},
+    {"_parallelDist_cpp_parallelKnn", (DL_FUNC) &_parallelDist_cpp_parallelKnn, 4},
+    {"_parallelDist_cpp_parallelDistFloat", (DL_FUNC) &_parallelDist_cpp_parallelDistFloat, 3},
+    {"_parallelDist_cpp_parallelDistProfile", (DL_FUNC) &_parallelDist_cpp_parallelDistProfile, 4},
+    {"_parallelDist_cpp_floatToDouble", (DL_FUNC) &_parallelDist_cpp_floatToDouble, 1},
+    {"_parallelDist_cpp_parallelDistFile", (DL_FUNC) &_parallelDist_cpp_parallelDistFile, 6},
+    {"_parallelDist_cpp_parallelRadius", (DL_FUNC) &_parallelDist_cpp_parallelRadius, 4},
+    {"_parallelDist_cpp_prepareDist", (DL_FUNC) &_parallelDist_cpp_prepareDist, 3},
+    {"_parallelDist_cpp_preparedCrossDist", (DL_FUNC) &_parallelDist_cpp_preparedCrossDist, 2},
+    {"_parallelDist_cpp_preparedKnn", (DL_FUNC) &_parallelDist_cpp_preparedKnn, 3},
+    {"_parallelDist_cpp_distFileInfo", (DL_FUNC) &_parallelDist_cpp_distFileInfo, 1},
+    {"_parallelDist_cpp_distFileRead", (DL_FUNC) &_parallelDist_cpp_distFileRead, 3},
+    {"_parallelDist_cpp_distFileVector", (DL_FUNC) &_parallelDist_cpp_distFileVector, 1},
     {NULL, NULL, 0}
 };
 
@@ -0,0 +1,195 @@
+// Tiling.h
+//
+// Copyright (C)  2017, 2021  Alexander Eckert
+//
+// This file is part of parallelDist.
+//
+// parallelDist is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// parallelDist is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TILING_H_
+#define TILING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+//==============================
+// Tile
+//==============================
+// Block of the distance matrix covering rows [rowBegin, rowEnd) and columns [colBegin, colEnd).
+// Diagonal tiles only contain the pairs below the diagonal (row > col), all other tiles lie entirely below it
+// (rowBegin >= colEnd).
+struct Tile {
+    uint64_t rowBegin;
+    uint64_t rowEnd;
+    uint64_t colBegin;
+    uint64_t colEnd;
+
+    bool isDiagonal() const {
+        return rowBegin == colBegin;
+    }
+
+    // number of distance pairs
+    uint64_t pairCount() const {
+        uint64_t rows = rowEnd - rowBegin;
+        return isDiagonal() ? rows * (rows - 1) / 2 : rows * (colEnd - colBegin);
+    }
+};
+
+//==============================
+// Triangular tiling
+//==============================
+// Splits the lower triangle of a n x n distance matrix into square tiles of equal size. Every off-diagonal
+// tile is one work item, the half-sized diagonal tiles are processed in pairs, so all work items cost
+// about the same number of distance evaluations. Consecutive work items share their row block, which keeps
+// the row observations in cache while a thread walks along the columns.
+// If the observations before first are already done (rows appended to an existing distance matrix), only the
+// rows from first on are tiled: a triangle of the new observations and a rectangle of new x old pairs.
+class TriangularTiling {
+  private:
+    uint64_t n;
+    uint64_t tileSize;
+    uint64_t first;
+    uint64_t blockCount;
+    uint64_t offDiagonalCount;
+    uint64_t firstBlockCount;
+
+    // tile of the triangle of the observations from first on
+    Tile block(uint64_t rowBlock, uint64_t colBlock) const {
+        Tile tile;
+        tile.rowBegin = first + rowBlock * tileSize;
+        tile.rowEnd = std::min(n, tile.rowBegin + tileSize);
+        tile.colBegin = first + colBlock * tileSize;
+        tile.colEnd = std::min(n, tile.colBegin + tileSize);
+        return tile;
+    }
+
+  public:
+    // per-core cache budget for the observations of one tile (typical L2 size)
+    static const uint64_t cacheBudget = 256 * 1024;
+    static const uint64_t maxTileSize = 512;
+    // keep enough blocks per dimension for load balancing on small inputs
+    static const uint64_t minBlockCount = 16;
+
+    TriangularTiling(uint64_t n, uint64_t tileSize, uint64_t first = 0)
+        : n(n), tileSize(std::max<uint64_t>(tileSize, 1)), first(std::min(first, n)) {
+        blockCount = (n - this->first + this->tileSize - 1) / this->tileSize;
+        offDiagonalCount = blockCount * (blockCount - (blockCount > 0 ? 1 : 0)) / 2;
+        firstBlockCount = (this->first + this->tileSize - 1) / this->tileSize;
+    }
+
+    /**
+     Tile size for which the row and column observations of a tile fit into the cache budget
+     @param n number of observations
+     @param bytesPerObservation memory footprint of one observation (0 if unknown)
+     @return edge length of a tile
+     */
+    static uint64_t tileSizeFor(uint64_t n, uint64_t bytesPerObservation) {
+        uint64_t size = maxTileSize;
+        if (bytesPerObservation > 0) {
+            size = std::min(size, cacheBudget / (2 * bytesPerObservation));
+        }
+        size = std::min(size, (n + minBlockCount - 1) / minBlockCount);
+        return std::max<uint64_t>(size, 1);
+    }
+
+    // number of work items
+    uint64_t size() const {
+        return offDiagonalCount + (blockCount + 1) / 2 + blockCount * firstBlockCount;
+    }
+
+    uint64_t getTileSize() const {
+        return tileSize;
+    }
+
+    /**
+     Tiles of a work item
+     @param k index of the work item
+     @param tiles output array for the tiles of the work item
+     @return number of tiles (1 or 2)
+     */
+    unsigned int getTiles(uint64_t k, Tile tiles[2]) const {
+        if (k < offDiagonalCount) {
+            // invert k = rowBlock * (rowBlock - 1) / 2 + colBlock with colBlock < rowBlock
+            uint64_t rowBlock = static_cast<uint64_t>((1.0 + std::sqrt(1.0 + 8.0 * k)) / 2.0);
+            while (rowBlock * (rowBlock - 1) / 2 > k) {
+                --rowBlock;
+            }
+            while ((rowBlock + 1) * rowBlock / 2 <= k) {
+                ++rowBlock;
+            }
+            tiles[0] = block(rowBlock, k - rowBlock * (rowBlock - 1) / 2);
+            return 1;
+        }
+        uint64_t diagonalItems = (blockCount + 1) / 2;
+        if (k >= offDiagonalCount + diagonalItems) {
+            // pairs of a new and an already done observation
+            uint64_t rectangular = k - offDiagonalCount - diagonalItems;
+            Tile &tile = tiles[0];
+            tile.rowBegin = first + (rectangular / firstBlockCount) * tileSize;
+            tile.rowEnd = std::min(n, tile.rowBegin + tileSize);
+            tile.colBegin = (rectangular % firstBlockCount) * tileSize;
+            tile.colEnd = std::min(first, tile.colBegin + tileSize);
+            return 1;
+        }
+        uint64_t diagonalBlock = 2 * (k - offDiagonalCount);
+        tiles[0] = block(diagonalBlock, diagonalBlock);
+        if (diagonalBlock + 1 < blockCount) {
+            tiles[1] = block(diagonalBlock + 1, diagonalBlock + 1);
+            return 2;
+        }
+        return 1;
+    }
+};
+
+//==============================
+// Rectangular tiling
+//==============================
+// Splits a m x n cross distance matrix into tiles of equal size. Consecutive work items share their
+// column block.
+class RectangularTiling {
+  private:
+    uint64_t m;
+    uint64_t n;
+    uint64_t tileSize;
+    uint64_t rowBlockCount;
+    uint64_t colBlockCount;
+
+  public:
+    RectangularTiling(uint64_t m, uint64_t n, uint64_t tileSize)
+        : m(m), n(n), tileSize(std::max<uint64_t>(tileSize, 1)) {
+        rowBlockCount = (m + this->tileSize - 1) / this->tileSize;
+        colBlockCount = (n + this->tileSize - 1) / this->tileSize;
+    }
+
+    // number of work items
+    uint64_t size() const {
+        return rowBlockCount * colBlockCount;
+    }
+
+    uint64_t getTileSize() const {
+        return tileSize;
+    }
+
+    Tile getTile(uint64_t k) const {
+        Tile tile;
+        tile.rowBegin = (k % rowBlockCount) * tileSize;
+        tile.rowEnd = std::min(m, tile.rowBegin + tileSize);
+        tile.colBegin = (k / rowBlockCount) * tileSize;
+        tile.colEnd = std::min(n, tile.colBegin + tileSize);
+        return tile;
+    }
+};
+
+#endif // TILING_H_
@@ -18,24 +18,22 @@
 // along with parallelDist. If not, see <http://www.gnu.org/licenses/>.
 
 #include <RcppArmadillo.h>
-#include <RcppParallel.h>
 
 #include <algorithm>
 #include <cmath>
-#include <iostream>
-#include <list>
+#include <memory>
 #include <vector>
 
+#include "DistanceCore.h"
 #include "DistanceFactory.h"
-#include "IDistance.h"
+#include "DistanceFile.h"
+#include "PreparedDataset.h"
+#include "Tiling.h"
 
-uint64_t sumForm(const uint64_t n) {
-    return ((n * n) + n) / 2;
-}
-
-uint64_t matToVecIdx(const uint64_t i, const uint64_t j, const uint64_t N) {
-    return i * N - i - sumForm(i) - 1 + j;
-}
+//==============================
+// R interface
+//==============================
+// Converts the arguments of the R functions for the distance core and its results back to R objects.
 
 inline bool isInteger(const std::string &s) {
     if (s.empty() || ((!isdigit(s[0])) && (s[0] != '-') && (s[0] != '+')))
@@ -45,72 +43,125 @@ inline bool isInteger(const std::string &s) {
     return (*p == 0);
 }
 
-struct DistanceVec : public RcppParallel::Worker {
-    // input vector of matrices
-    const std::vector<arma::mat> &seriesVec;
-
-    int vecSize = 0;
-
-    // output vector by reference
-    Rcpp::NumericVector &rvec;
+// Convert list to vector of double matrices
+std::vector<arma::mat> listToMatrices(const Rcpp::List &dataList) {
+    std::vector<arma::mat> listVec;
+    for (Rcpp::List::const_iterator it = dataList.begin(); it != dataList.end(); ++it) {
+        listVec.push_back(Rcpp::as<arma::mat>(*it));
+    }
+    return listVec;
+}
 
-    // distance function
-    std::shared_ptr<IDistance> distance;
+void setVectorAttributes(Rcpp::NumericVector &rvec, const Rcpp::List &attrs) {
+    rvec.attr("Size") = attrs["Size"];
+    rvec.attr("Labels") = attrs["Labels"];
+    rvec.attr("Diag") = Rcpp::as<bool>(attrs["Diag"]);
+    rvec.attr("Upper") = Rcpp::as<bool>(attrs["Upper"]);
+    rvec.attr("method") = attrs["method"];
+    rvec.attr("call") = attrs["call"];
+    rvec.attr("class") = "dist";
+}
 
-    // initialize from Rcpp input and output matrixes (the RMatrix class
-    // can be automatically converted to from the Rcpp matrix type)
-    DistanceVec(const std::vector<arma::mat> &seriesVec, Rcpp::NumericVector &rvec,
-                const std::shared_ptr<IDistance> &distance)
-        : seriesVec(seriesVec), rvec(rvec), distance(distance) {
-        vecSize = seriesVec.size();
+// Distance options from the attributes of the dist object and the additional arguments of parDist
+DistanceOptions distanceOptions(const Rcpp::List &attrs, const Rcpp::List &arguments) {
+    DistanceOptions options(Rcpp::as<std::string>(attrs["method"]));
+    if (arguments.containsElementNamed("engine")) {
+        options.engine = Rcpp::as<std::string>(arguments["engine"]);
     }
-
-    void operator()(std::size_t begin, std::size_t end) {
-        for (std::size_t i = begin; i < end; i++) {
-            for (std::size_t j = 0; j < i; j++) {
-                rvec[matToVecIdx(j, i, vecSize)] = distance->calcDistance(seriesVec.at(i), seriesVec.at(j));
-            }
-        }
+    if (arguments.containsElementNamed("p")) {
+        options.p = Rcpp::as<double>(arguments["p"]);
     }
-};
-
-// uses not a list but the matrix
-struct DistanceMatrixVec : public RcppParallel::Worker {
-    // input vector of matrices
-    const arma::mat &seriesVec;
+    if (arguments.containsElementNamed("cov")) {
+        options.cov = Rcpp::as<arma::mat>(arguments["cov"]);
+    }
+    if (arguments.containsElementNamed("inverted")) {
+        options.inverted = Rcpp::as<bool>(arguments["inverted"]);
+    }
+    options.warpingWindow = arguments.containsElementNamed("window.size");
+    if (options.warpingWindow) {
+        options.windowSize = Rcpp::as<unsigned int>(arguments["window.size"]);
+    }
+    if (arguments.containsElementNamed("norm.method")) {
+        options.normMethod = Rcpp::as<std::string>(arguments["norm.method"]);
+    }
+    if (arguments.containsElementNamed("step.pattern")) {
+        options.stepPattern = Rcpp::as<std::string>(arguments["step.pattern"]);
+    }
+    if (arguments.containsElementNamed("func")) {
+        SEXP func_ = arguments["func"];
+        options.customFunction = *Rcpp::XPtr<funcPtr>(func_);
+    }
+    return options;
+}
 
-    int vecSize = 0;
+std::shared_ptr<IDistance> createDistance(const arma::mat &dataMatrix, const Rcpp::List &attrs,
+                                          const Rcpp::List &arguments) {
+    return DistanceFactory(dataMatrix).createDistanceFunction(distanceOptions(attrs, arguments));
+}
 
-    // output vector by reference
-    Rcpp::NumericVector &rvec;
+std::shared_ptr<IDistance> createDistance(const std::vector<arma::mat> &listVec, const Rcpp::List &attrs,
+                                          const Rcpp::List &arguments) {
+    return DistanceFactory(listVec).createDistanceFunction(distanceOptions(attrs, arguments));
+}
 
-    // distance function
-    std::shared_ptr<IDistance> distance;
+inline void checkInterruptFunction(void *) {
+    R_CheckUserInterrupt();
+}
 
-    // initialize from Rcpp input and output matrixes (the RMatrix class
-    // can be automatically converted to from the Rcpp matrix type)
-    DistanceMatrixVec(const arma::mat &seriesVec, Rcpp::NumericVector &rvec, const std::shared_ptr<IDistance> &distance)
-        : seriesVec(seriesVec), rvec(rvec), distance(distance) {
-        vecSize = seriesVec.n_rows;
+// Progress without a record which checks for user interrupts of the R session and ends with an R interrupt
+class RProgress : public Progress {
+  public:
+    // checks for a user interrupt without leaving the calling function, called on the main thread
+    bool interruptPending() {
+        return R_ToplevelExec(checkInterruptFunction, NULL) == FALSE;
     }
 
-    void operator()(std::size_t begin, std::size_t end) {
-        for (std::size_t i = begin; i < end; i++) {
-            for (std::size_t j = 0; j < i; j++) {
-                rvec[matToVecIdx(j, i, vecSize)] = distance->calcDistance(seriesVec.row(i), seriesVec.row(j));
-            }
-        }
+    void interrupt() {
+        throw Rcpp::internal::InterruptedException();
     }
 };
 
-void setVectorAttributes(Rcpp::NumericVector &rvec, const Rcpp::List &attrs) {
-    rvec.attr("Size") = attrs["Size"];
-    rvec.attr("Labels") = attrs["Labels"];
-    rvec.attr("Diag") = Rcpp::as<bool>(attrs["Diag"]);
-    rvec.attr("Upper") = Rcpp::as<bool>(attrs["Upper"]);
-    rvec.attr("method") = attrs["method"];
-    rvec.attr("call") = attrs["call"];
-    rvec.attr("class") = "dist";
+/**
+ Profile as R list
+ @param profile profile of a calculation
+ @return list with the total wall time, the data frames phases and threads and the totals of the parallel loop
+ */
+Rcpp::List profileToList(const Profile &profile) {
+    const std::vector<Profile::Phase> &phases = profile.getPhases();
+    const std::vector<Profile::ThreadStats> &threads = profile.getThreads();
+    double parallelSeconds = profile.getParallelSeconds();
+    Rcpp::CharacterVector phaseNames(phases.size());
+    Rcpp::NumericVector phaseSeconds(phases.size()), phaseBytes(phases.size());
+    for (std::size_t i = 0; i < phases.size(); i++) {
+        phaseNames[i] = phases[i].name;
+        phaseSeconds[i] = phases[i].seconds;
+        phaseBytes[i] = phases[i].bytes;
+    }
+    Rcpp::IntegerVector threadIds(threads.size());
+    Rcpp::NumericVector busy(threads.size()), idle(threads.size()), workItems(threads.size()),
+        tiles(threads.size()), pairs(threads.size());
+    double totalTiles = 0, totalPairs = 0, totalWorkItems = 0;
+    for (std::size_t i = 0; i < threads.size(); i++) {
+        threadIds[i] = static_cast<int>(i + 1);
+        busy[i] = threads[i].busy;
+        idle[i] = parallelSeconds > threads[i].busy ? parallelSeconds - threads[i].busy : 0.0;
+        workItems[i] = static_cast<double>(threads[i].workItems);
+        tiles[i] = static_cast<double>(threads[i].tiles);
+        pairs[i] = static_cast<double>(threads[i].pairs);
+        totalWorkItems += workItems[i];
+        totalTiles += tiles[i];
+        totalPairs += pairs[i];
+    }
+    Rcpp::DataFrame phaseFrame = Rcpp::DataFrame::create(
+        Rcpp::Named("phase") = phaseNames, Rcpp::Named("seconds") = phaseSeconds, Rcpp::Named("bytes") = phaseBytes,
+        Rcpp::Named("stringsAsFactors") = false);
+    Rcpp::DataFrame threadFrame = Rcpp::DataFrame::create(
+        Rcpp::Named("thread") = threadIds, Rcpp::Named("busy") = busy, Rcpp::Named("idle") = idle,
+        Rcpp::Named("workItems") = workItems, Rcpp::Named("tiles") = tiles, Rcpp::Named("pairs") = pairs);
+    return Rcpp::List::create(Rcpp::Named("seconds") = profile.getTotal(), Rcpp::Named("phases") = phaseFrame,
+                              Rcpp::Named("threads") = threadFrame, Rcpp::Named("pairs") = totalPairs,
+                              Rcpp::Named("tiles") = totalTiles, Rcpp::Named("workItems") = totalWorkItems,
+                              Rcpp::Named("chunks") = static_cast<double>(profile.getChunks()));
 }
 
 // [[Rcpp::export]]
@@ -121,37 +172,425 @@ Rcpp::NumericVector cpp_parallelDistVec(Rcpp::List dataList, Rcpp::List attrs, R
 
     setVectorAttributes(rvec, attrs);
 
-    // Convert list to vector of double matrices
-    std::vector<arma::mat> listVec;
-    for (Rcpp::List::iterator it = dataList.begin(); it != dataList.end(); ++it) {
-        listVec.push_back(Rcpp::as<arma::mat>(*it));
-    }
-    std::shared_ptr<IDistance> distanceFunction = DistanceFactory(listVec).createDistanceFunction(attrs, arguments);
+    RProgress progress;
+    calcDistVec(listToMatrices(dataList), distanceOptions(attrs, arguments), rvec.begin(), progress);
+    return rvec;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericVector cpp_parallelDistMatrixVec(SEXP x, Rcpp::List attrs, Rcpp::List arguments) {
+    uint64_t n = Rf_nrows(x);
+    uint64_t dim = Rf_ncols(x);
 
-    DistanceVec *distanceWorker = new DistanceVec(listVec, rvec, distanceFunction);
-    // call it with parallelFor
-    RcppParallel::parallelFor(0, n, (*distanceWorker));
-    delete distanceWorker;
-    distanceWorker = NULL;
+    // result matrix
+    Rcpp::NumericVector rvec(sumForm(n) - n);
+
+    setVectorAttributes(rvec, attrs);
 
+    RProgress progress;
+    DistanceOptions options = distanceOptions(attrs, arguments);
+    // integer, logical and raw matrices are read in place in their own width
+    switch (TYPEOF(x)) {
+    case INTSXP:
+    case LGLSXP:
+        calcDistElements(reinterpret_cast<const int32_t *>(INTEGER(x)), n, dim, options, rvec.begin(), progress);
+        break;
+    case RAWSXP:
+        calcDistElements(reinterpret_cast<const uint8_t *>(RAW(x)), n, dim, options, rvec.begin(), progress);
+        break;
+    case REALSXP:
+        // the memory of R is used without a copy, the observations are transposed once
+        calcDistMatrix(arma::mat(REAL(x), n, dim, false, true), options, rvec.begin(), progress);
+        break;
+    default:
+        calcDistMatrix(Rcpp::as<arma::mat>(x), options, rvec.begin(), progress);
+    }
     return rvec;
 }
 
 // [[Rcpp::export]]
-Rcpp::NumericVector cpp_parallelDistMatrixVec(arma::mat dataMatrix, Rcpp::List attrs, Rcpp::List arguments) {
+Rcpp::List cpp_parallelBinaryDistMatrix(const arma::mat &dataMatrix, Rcpp::List attrs,
+                                        Rcpp::CharacterVector methods) {
     uint64_t n = dataMatrix.n_rows;
 
+    // one result vector per measure
+    Rcpp::List result(methods.size());
+    std::vector<DistanceOptions> options;
+    std::vector<double *> outputs;
+    for (R_xlen_t m = 0; m < methods.size(); m++) {
+        Rcpp::NumericVector rvec(sumForm(n) - n);
+        setVectorAttributes(rvec, attrs);
+        rvec.attr("method") = methods[m];
+        options.push_back(DistanceOptions(Rcpp::as<std::string>(methods[m])));
+        outputs.push_back(rvec.begin());
+        result[m] = rvec;
+    }
+    result.attr("names") = methods;
+
+    RProgress progress;
+    calcBinaryDistMatrix(dataMatrix, options, outputs, progress);
+    return result;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericVector cpp_parallelDistSparse(Rcpp::IntegerVector p, Rcpp::IntegerVector indices, Rcpp::NumericVector x,
+                                           Rcpp::IntegerVector dim, bool byRow, Rcpp::List attrs,
+                                           Rcpp::List arguments) {
+    uint64_t n = dim[0];
+
+    // nonzero elements of the rows, in compressed sparse column (dgCMatrix) or row (dgRMatrix) form
+    SparseObservations observations =
+        byRow ? SparseObservations::fromRows(dim[0], dim[1], p.begin(), indices.begin(), x.begin())
+              : SparseObservations::fromColumns(dim[0], dim[1], p.begin(), indices.begin(), x.begin());
+
     // result matrix
     Rcpp::NumericVector rvec(sumForm(n) - n);
 
     setVectorAttributes(rvec, attrs);
 
-    std::shared_ptr<IDistance> distanceFunction = DistanceFactory(dataMatrix).createDistanceFunction(attrs, arguments);
-    DistanceMatrixVec *distanceWorker = new DistanceMatrixVec(dataMatrix, rvec, distanceFunction);
-    // call it with parallelFor
-    RcppParallel::parallelFor(0, n, (*distanceWorker));
-    delete distanceWorker;
-    distanceWorker = NULL;
+    RProgress progress;
+    calcDistSparse(observations, distanceOptions(attrs, arguments), rvec.begin(), progress);
+    return rvec;
+}
+
+// Calculates the condensed distance vector of a matrix or a list of matrices into output
+template <typename T>
+void calcDist(SEXP x, const Rcpp::List &attrs, const Rcpp::List &arguments, T *output, Progress &progress,
+              Profile *profile = NULL) {
+    if (Rf_isMatrix(x)) {
+        arma::mat dataMatrix;
+        {
+            ProfilePhase phase(profile, "input");
+            dataMatrix = Rcpp::as<arma::mat>(x);
+            phase.allocated(dataMatrix.n_elem * sizeof(double));
+        }
+        calcDistMatrix(dataMatrix, distanceOptions(attrs, arguments), output, progress, profile);
+    } else {
+        std::vector<arma::mat> listVec;
+        {
+            ProfilePhase phase(profile, "input");
+            listVec = listToMatrices(Rcpp::List(x));
+            for (std::size_t i = 0; i < listVec.size(); i++) {
+                phase.allocated(listVec[i].n_elem * sizeof(double));
+            }
+        }
+        calcDistVec(listVec, distanceOptions(attrs, arguments), output, progress, profile);
+    }
+}
+
+// [[Rcpp::export]]
+Rcpp::RawVector cpp_parallelDistFloat(SEXP x, Rcpp::List attrs, Rcpp::List arguments) {
+    uint64_t n = static_cast<uint64_t>(Rcpp::as<double>(attrs["Size"]));
+    // packed single precision distances
+    Rcpp::RawVector rvec((sumForm(n) - n) * sizeof(float));
+    RProgress progress;
+    calcDist(x, attrs, arguments, reinterpret_cast<float *>(rvec.begin()), progress);
+    return rvec;
+}
+
+// [[Rcpp::export]]
+SEXP cpp_parallelDistProfile(SEXP x, Rcpp::List attrs, Rcpp::List arguments, bool singlePrecision) {
+    Profile profile;
+    Profile::Clock::time_point start = Profile::Clock::now();
+    uint64_t n = static_cast<uint64_t>(Rcpp::as<double>(attrs["Size"]));
+    RProgress progress;
+    Rcpp::RObject result;
+    if (singlePrecision) {
+        Rcpp::RawVector rvec;
+        {
+            ProfilePhase phase(&profile, "output");
+            rvec = Rcpp::RawVector((sumForm(n) - n) * sizeof(float));
+            phase.allocated(rvec.size());
+        }
+        calcDist(x, attrs, arguments, reinterpret_cast<float *>(rvec.begin()), progress, &profile);
+        result = rvec;
+    } else {
+        Rcpp::NumericVector rvec;
+        {
+            ProfilePhase phase(&profile, "output");
+            rvec = Rcpp::NumericVector(sumForm(n) - n);
+            setVectorAttributes(rvec, attrs);
+            phase.allocated(rvec.size() * sizeof(double));
+        }
+        calcDist(x, attrs, arguments, rvec.begin(), progress, &profile);
+        result = rvec;
+    }
+    profile.setTotal(Profile::secondsSince(start));
+    result.attr("profile") = profileToList(profile);
+    return result;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericVector cpp_floatToDouble(Rcpp::RawVector packed) {
+    const float *values = reinterpret_cast<const float *>(packed.begin());
+    Rcpp::NumericVector rvec(packed.size() / sizeof(float));
+    std::copy(values, values + rvec.size(), rvec.begin());
+    return rvec;
+}
+
+// Progress record in the header of a distance file, a calculation with a different tiling starts anew
+class FileProgress : public RProgress {
+  private:
+    DistanceFile &file;
 
+  public:
+    explicit FileProgress(DistanceFile &file) : file(file) {}
+
+    uint64_t start(const TriangularTiling &tiling) {
+        const DistanceFile::Header &header = file.getHeader();
+        if (header.tileSize == tiling.getTileSize() && header.workItems == tiling.size()) {
+            return header.completed;
+        }
+        file.setProgress(tiling.getTileSize(), tiling.size(), 0);
+        return 0;
+    }
+
+    void completed(uint64_t completed) {
+        file.setProgress(file.getHeader().tileSize, file.getHeader().workItems, completed);
+    }
+};
+
+// [[Rcpp::export]]
+void cpp_parallelDistFile(SEXP x, Rcpp::List attrs, Rcpp::List arguments, std::string path, bool singlePrecision,
+                          bool resume) {
+    DistanceFile::Header header;
+    header.size = static_cast<uint64_t>(Rcpp::as<double>(attrs["Size"]));
+    header.elementSize = singlePrecision ? sizeof(float) : sizeof(double);
+    header.method = Rcpp::as<std::string>(attrs["method"]);
+    if (!Rf_isNull(attrs["Labels"])) {
+        header.labels = Rcpp::as<std::vector<std::string>>(attrs["Labels"]);
+    }
+    std::unique_ptr<DistanceFile> file;
+    if (resume) {
+        // continue the calculation of an existing file
+        file.reset(new DistanceFile(path, true));
+        const DistanceFile::Header &existing = file->getHeader();
+        if (existing.size != header.size || existing.elementSize != header.elementSize ||
+            existing.method != header.method || existing.labels != header.labels) {
+            Rcpp::stop("File '" + path + "' holds the distances of a different calculation.");
+        }
+    } else {
+        file.reset(new DistanceFile(path, header));
+    }
+    FileProgress progress(*file);
+    if (singlePrecision) {
+        calcDist(x, attrs, arguments, static_cast<float *>(file->data()), progress);
+    } else {
+        calcDist(x, attrs, arguments, static_cast<double *>(file->data()), progress);
+    }
+}
+
+// [[Rcpp::export]]
+Rcpp::List cpp_distFileInfo(std::string path) {
+    DistanceFile file(path);
+    const DistanceFile::Header &header = file.getHeader();
+    Rcpp::RObject labels = R_NilValue;
+    if (!header.labels.empty()) {
+        labels = Rcpp::wrap(header.labels);
+    }
+    return Rcpp::List::create(Rcpp::Named("Size") = static_cast<double>(header.size),
+                              Rcpp::Named("method") = header.method, Rcpp::Named("Labels") = labels,
+                              Rcpp::Named("Complete") = header.isComplete());
+}
+
+// Reads the distance between observations i and j (0-based) of a distance file
+inline double readDistance(const DistanceFile &file, uint64_t i, uint64_t j) {
+    if (i == j) {
+        return 0.0;
+    }
+    const DistanceFile::Header &header = file.getHeader();
+    uint64_t idx = matToVecIdx(std::min(i, j), std::max(i, j), header.size);
+    if (header.elementSize == sizeof(float)) {
+        return static_cast<const float *>(file.data())[idx];
+    }
+    return static_cast<const double *>(file.data())[idx];
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericMatrix cpp_distFileRead(std::string path, Rcpp::IntegerVector rows, Rcpp::IntegerVector cols) {
+    DistanceFile file(path);
+    uint64_t n = file.getHeader().size;
+    for (R_xlen_t k = 0; k < rows.size() + cols.size(); k++) {
+        int idx = k < rows.size() ? rows[k] : cols[k - rows.size()];
+        if (idx == NA_INTEGER || idx < 1 || static_cast<uint64_t>(idx) > n) {
+            Rcpp::stop("Index out of bounds.");
+        }
+    }
+    Rcpp::NumericMatrix result(rows.size(), cols.size());
+    for (R_xlen_t c = 0; c < cols.size(); c++) {
+        for (R_xlen_t r = 0; r < rows.size(); r++) {
+            result(r, c) = readDistance(file, rows[r] - 1, cols[c] - 1);
+        }
+    }
+    return result;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericVector cpp_distFileVector(std::string path) {
+    DistanceFile file(path);
+    const DistanceFile::Header &header = file.getHeader();
+    Rcpp::NumericVector rvec(header.count());
+    if (header.elementSize == sizeof(float)) {
+        const float *data = static_cast<const float *>(file.data());
+        std::copy(data, data + header.count(), rvec.begin());
+    } else {
+        const double *data = static_cast<const double *>(file.data());
+        std::copy(data, data + header.count(), rvec.begin());
+    }
     return rvec;
 }
+
+// [[Rcpp::export]]
+Rcpp::NumericVector cpp_parallelDistAppend(Rcpp::NumericVector d, SEXP x, SEXP y, Rcpp::List attrs,
+                                           Rcpp::List arguments) {
+    uint64_t n = static_cast<uint64_t>(Rcpp::as<double>(attrs["Size"]));
+    Rcpp::NumericVector rvec(sumForm(n) - n);
+    setVectorAttributes(rvec, attrs);
+
+    RProgress progress;
+    if (Rf_isMatrix(x)) {
+        arma::mat xMatrix = Rcpp::as<arma::mat>(x);
+        arma::mat dataMatrix = arma::join_cols(xMatrix, Rcpp::as<arma::mat>(y));
+        // precalculations like the covariance matrix stay fixed to the existing observations
+        std::shared_ptr<IDistance> distanceFunction = createDistance(xMatrix, attrs, arguments);
+        copyDistances(d.begin(), xMatrix.n_rows, rvec.begin(), n);
+        calcDistMatrix(dataMatrix, distanceFunction, rvec.begin(), xMatrix.n_rows, progress);
+    } else {
+        std::vector<arma::mat> xVec = listToMatrices(Rcpp::List(x));
+        std::vector<arma::mat> listVec = xVec;
+        std::vector<arma::mat> yVec = listToMatrices(Rcpp::List(y));
+        listVec.insert(listVec.end(), yVec.begin(), yVec.end());
+        std::shared_ptr<IDistance> distanceFunction = createDistance(xVec, attrs, arguments);
+        copyDistances(d.begin(), xVec.size(), rvec.begin(), n);
+        calcDistVec(listVec, distanceFunction, rvec.begin(), xVec.size(), progress);
+    }
+    return rvec;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericMatrix cpp_parallelCrossDist(SEXP x, SEXP y, Rcpp::List attrs, Rcpp::List arguments) {
+    if (Rf_isMatrix(x)) {
+        arma::mat xMatrix = Rcpp::as<arma::mat>(x);
+        arma::mat yMatrix = Rcpp::as<arma::mat>(y);
+        Rcpp::NumericMatrix rmat(xMatrix.n_rows, yMatrix.n_rows);
+        // precalculations like the covariance matrix are based on the reference observations y
+        calcCrossDistMatrix(xMatrix, yMatrix, createDistance(yMatrix, attrs, arguments), rmat.begin());
+        return rmat;
+    } else {
+        std::vector<arma::mat> xVec = listToMatrices(Rcpp::List(x));
+        std::vector<arma::mat> yVec = listToMatrices(Rcpp::List(y));
+        Rcpp::NumericMatrix rmat(xVec.size(), yVec.size());
+        calcCrossDistVec(xVec, yVec, createDistance(yVec, attrs, arguments), rmat.begin());
+        return rmat;
+    }
+}
+
+// Neighbour indices (1-based) and distances as n x k matrices
+Rcpp::List neighbourMatrices(const NeighbourHeaps &heaps, uint64_t n, uint64_t k) {
+    Rcpp::IntegerMatrix index(n, k);
+    Rcpp::NumericMatrix distance(n, k);
+    for (uint64_t i = 0; i < n; i++) {
+        std::vector<NeighbourHeaps::Neighbour> neighbours = heaps.sorted(i);
+        for (uint64_t c = 0; c < k; c++) {
+            if (c < neighbours.size()) {
+                index[c * n + i] = static_cast<int>(neighbours[c].second + 1);
+                distance[c * n + i] = neighbours[c].first;
+            } else {
+                index[c * n + i] = NA_INTEGER;
+                distance[c * n + i] = NA_REAL;
+            }
+        }
+    }
+    return Rcpp::List::create(Rcpp::Named("index") = index, Rcpp::Named("distance") = distance);
+}
+
+// [[Rcpp::export]]
+Rcpp::List cpp_parallelKnn(SEXP x, int k, Rcpp::List attrs, Rcpp::List arguments) {
+    if (Rf_isMatrix(x)) {
+        arma::mat dataMatrix = Rcpp::as<arma::mat>(x);
+        NeighbourHeaps heaps = calcKnnMatrix(dataMatrix, createDistance(dataMatrix, attrs, arguments), k);
+        return neighbourMatrices(heaps, dataMatrix.n_rows, k);
+    } else {
+        std::vector<arma::mat> listVec = listToMatrices(Rcpp::List(x));
+        NeighbourHeaps heaps = calcKnnVec(listVec, createDistance(listVec, attrs, arguments), k);
+        return neighbourMatrices(heaps, listVec.size(), k);
+    }
+}
+
+// Pairs as triplets (1-based, i < j) ordered like the entries of a dist object
+Rcpp::List radiusTriplets(const RadiusPairs &pairs) {
+    std::vector<std::size_t> order(pairs.distances.size());
+    for (std::size_t k = 0; k < order.size(); k++) {
+        order[k] = k;
+    }
+    std::sort(order.begin(), order.end(), [&pairs](std::size_t a, std::size_t b) {
+        return pairs.cols[a] != pairs.cols[b] ? pairs.cols[a] < pairs.cols[b] : pairs.rows[a] < pairs.rows[b];
+    });
+    Rcpp::IntegerVector i(order.size()), j(order.size());
+    Rcpp::NumericVector distance(order.size());
+    for (std::size_t k = 0; k < order.size(); k++) {
+        i[k] = static_cast<int>(pairs.cols[order[k]] + 1);
+        j[k] = static_cast<int>(pairs.rows[order[k]] + 1);
+        distance[k] = pairs.distances[order[k]];
+    }
+    return Rcpp::List::create(Rcpp::Named("i") = i, Rcpp::Named("j") = j, Rcpp::Named("distance") = distance);
+}
+
+// [[Rcpp::export]]
+Rcpp::List cpp_parallelRadius(SEXP x, double radius, Rcpp::List attrs, Rcpp::List arguments) {
+    if (Rf_isMatrix(x)) {
+        arma::mat dataMatrix = Rcpp::as<arma::mat>(x);
+        return radiusTriplets(calcRadiusMatrix(dataMatrix, createDistance(dataMatrix, attrs, arguments), radius));
+    } else {
+        std::vector<arma::mat> listVec = listToMatrices(Rcpp::List(x));
+        return radiusTriplets(calcRadiusVec(listVec, createDistance(listVec, attrs, arguments), radius));
+    }
+}
+
+// [[Rcpp::export]]
+SEXP cpp_prepareDist(SEXP x, Rcpp::List attrs, Rcpp::List arguments) {
+    PreparedDataset *prepared;
+    if (Rf_isMatrix(x)) {
+        prepared = new PreparedDataset(Rcpp::as<arma::mat>(x), distanceOptions(attrs, arguments));
+    } else {
+        prepared = new PreparedDataset(listToMatrices(Rcpp::List(x)), distanceOptions(attrs, arguments));
+    }
+    return Rcpp::XPtr<PreparedDataset>(prepared, true);
+}
+
+// Dataset of a prepared handle, external pointers are empty after the handle was saved and loaded again
+const PreparedDataset &preparedDataset(SEXP prepared) {
+    Rcpp::XPtr<PreparedDataset> dataset(prepared);
+    if (dataset.get() == NULL) {
+        Rcpp::stop("The prepared dataset is no longer available, e.g. after saving and loading it. Prepare it again.");
+    }
+    return *dataset;
+}
+
+// [[Rcpp::export]]
+Rcpp::NumericMatrix cpp_preparedCrossDist(SEXP prepared, SEXP x) {
+    const PreparedDataset &dataset = preparedDataset(prepared);
+    if (Rf_isMatrix(x)) {
+        arma::mat queries = Rcpp::as<arma::mat>(x);
+        Rcpp::NumericMatrix rmat(queries.n_rows, dataset.size());
+        dataset.crossDistances(queries, rmat.begin());
+        return rmat;
+    } else {
+        std::vector<arma::mat> queries = listToMatrices(Rcpp::List(x));
+        Rcpp::NumericMatrix rmat(queries.size(), dataset.size());
+        dataset.crossDistances(queries, rmat.begin());
+        return rmat;
+    }
+}
+
+// [[Rcpp::export]]
+Rcpp::List cpp_preparedKnn(SEXP prepared, SEXP x, int k) {
+    const PreparedDataset &dataset = preparedDataset(prepared);
+    if (Rf_isMatrix(x)) {
+        arma::mat queries = Rcpp::as<arma::mat>(x);
+        return neighbourMatrices(dataset.nearestNeighbours(queries, k), queries.n_rows, k);
+    } else {
+        std::vector<arma::mat> queries = listToMatrices(Rcpp::List(x));
+        return neighbourMatrices(dataset.nearestNeighbours(queries, k), queries.size(), k);
+    }
+}